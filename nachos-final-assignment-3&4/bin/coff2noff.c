@@ -15,6 +15,11 @@
  *	.data	-- initialized data
  *	.bss/.sbss -- uninitialized data (should be zero'd on program startup)
  *
+ * The initialized data is placed in the NOFF file as far after the code
+ * as it is in the address space, so that the kernel can demand load any
+ * page from code.inFileAddr + page * PageSize.  test/script starts the
+ * data on a page boundary, so that no page holds both code and data.
+ *
  * Copyright (c) 1992-1993 The Regents of the University of California.
  * All rights reserved.  See copyright.h for copyright notice and limitation 
  * of liability and disclaimer of warranty provisions.
@@ -92,7 +97,7 @@ void Write(int fd, char *buf, int nBytes)
 
 main (int argc, char **argv)
 {
-    int fdIn, fdOut, numsections, i, inNoffFile;
+    int fdIn, fdOut, numsections, i, inNoffFile, gap;
     struct filehdr fileh;
     struct aouthdr systemh;
     struct scnhdr *sections;
@@ -187,6 +192,22 @@ main (int argc, char **argv)
 	        unlink(noffFileName);
 	        exit(1);
 	    }
+	    /* pad the file up to where the data is in the address space */
+	    if (noffH.code.size != 0) {
+		gap = (sections[i].s_paddr - noffH.code.virtualAddr)
+			- (inNoffFile - noffH.code.inFileAddr);
+		if (gap < 0) {
+		    fprintf(stderr, "Data overlaps the code\n");
+		    unlink(noffFileName);
+		    exit(1);
+		}
+		if (gap > 0) {
+		    buffer = calloc(gap, 1);
+		    Write(fdOut, buffer, gap);
+		    free(buffer);
+		    inNoffFile += gap;
+		}
+	    }
 	    noffH.initData.virtualAddr = sections[i].s_paddr;
 	    noffH.initData.inFileAddr = inNoffFile;
 	    noffH.initData.size = sections[i].s_size;
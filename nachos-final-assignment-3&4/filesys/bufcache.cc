@@ -0,0 +1,438 @@
+// bufcache.cc
+//	Routines to keep recently used disk sectors in memory, and to
+//	write the changed ones back to disk.
+//
+//	The slots are searched linearly; there are few of them, and a
+//	search costs nothing next to a disk access.  Disk I/O is never
+//	done holding the lock: the slot involved is marked busy instead,
+//	so other threads can use the rest of the cache meanwhile.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "bufcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// FlushThread
+// 	The procedure the flush daemon runs.  "arg" is the BufferCache.
+//----------------------------------------------------------------------
+
+static void
+FlushThread(int arg)
+{
+    ((BufferCache *)arg)->FlushDaemon();
+}
+
+//----------------------------------------------------------------------
+// ReadAheadThread
+// 	The procedure the read-ahead daemon runs.  "arg" is the
+//	BufferCache.
+//----------------------------------------------------------------------
+
+static void
+ReadAheadThread(int arg)
+{
+    ((BufferCache *)arg)->ReadAheadDaemon();
+}
+
+// A run of sectors waiting for the read-ahead daemon.
+
+class Prefetching {
+  public:
+    int first;
+    int count;
+};
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize a cache with every slot empty.
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache()
+{
+    int i;
+
+    for (i = 0; i < NumCacheSlots; i++) {
+	slots[i].sector = slots[i].writingBack = -1;
+	slots[i].dirty = slots[i].busy = FALSE;
+	slots[i].lastUse = 0;
+    }
+    lock = new Lock("buffer cache");
+    slotFree = new Condition("buffer cache slot free");
+    dirtied = new Condition("buffer cache dirtied");
+    uses = 0;
+    flusher = NULL;
+    prefetches = new SynchList;
+    reader = NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	De-allocate the cache.  Whatever is dirty in it is lost.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache()
+{
+    delete prefetches;
+    delete slotFree;
+    delete dirtied;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Find, BufferCache::WritingBack, BufferCache::Dirty,
+//	BufferCache::Victim
+// 	Searches of the slots; the caller holds the lock.  The victim
+//	is an empty slot if there is one, or else the one used least
+//	recently; -1 if every slot is busy.
+//----------------------------------------------------------------------
+
+int
+BufferCache::Find(int sector)
+{
+    int i;
+
+    for (i = 0; i < NumCacheSlots; i++)
+	if (slots[i].sector == sector)
+	    return i;
+    return -1;
+}
+
+bool
+BufferCache::WritingBack(int sector)
+{
+    int i;
+
+    for (i = 0; i < NumCacheSlots; i++)
+	if (slots[i].writingBack == sector)
+	    return TRUE;
+    return FALSE;
+}
+
+bool
+BufferCache::Dirty()
+{
+    int i;
+
+    for (i = 0; i < NumCacheSlots; i++)
+	if (slots[i].dirty)
+	    return TRUE;
+    return FALSE;
+}
+
+int
+BufferCache::Victim()
+{
+    int i, victim = -1;
+
+    for (i = 0; i < NumCacheSlots; i++) {
+	if (slots[i].busy)
+	    continue;
+	if (slots[i].sector == -1)
+	    return i;
+	if ((victim == -1) || (slots[i].lastUse < slots[victim].lastUse))
+	    victim = i;
+    }
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Grab
+// 	Return a slot for "sector", marked busy for the caller.  On a hit
+//	("*hit" is set) the slot holds the sector.  On a miss, the slot
+//	that held something else has been written back if it was dirty,
+//	and the caller must fill it in before releasing it.
+//
+//	If "mayWait" is FALSE, -1 is returned rather than waiting for a
+//	busy slot, and also on a hit: the caller only wants a slot to
+//	read the sector into.
+//----------------------------------------------------------------------
+
+int
+BufferCache::Grab(int sector, bool *hit, bool mayWait)
+{
+    CacheSlot *slot;
+    int which, victim;
+
+    lock->Acquire();
+    for (;;) {
+	which = Find(sector);
+	if ((which != -1) && !mayWait) {
+	    lock->Release();
+	    return -1;
+	}
+	if ((which != -1) && !slots[which].busy) {
+	    *hit = TRUE;
+	    break;
+	}
+	if ((which == -1) && !WritingBack(sector)) {
+	    which = Victim();
+	    if (which != -1) {
+		*hit = FALSE;
+		break;
+	    }
+	}
+	if (!mayWait) {
+	    lock->Release();
+	    return -1;
+	}
+	slotFree->Wait(lock);
+    }
+
+    slot = &slots[which];
+    slot->busy = TRUE;
+    slot->lastUse = uses++;
+    if (*hit) {
+	stats->numCacheHits++;
+	lock->Release();
+	return which;
+    }
+
+    stats->numCacheMisses++;
+    victim = slot->dirty ? slot->sector : -1;
+    slot->writingBack = victim;
+    slot->sector = sector;
+    slot->dirty = FALSE;
+    lock->Release();
+
+    if (victim != -1) {
+	DEBUG('f', "Buffer cache writing back sector %d\n", victim);
+	synchDisk->WriteSector(victim, slot->data);
+    }
+    return which;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Release
+// 	The caller is done with busy "slot"; "changed" if it changed the
+//	data.  Wake up anyone waiting for a slot, and the flush daemon if
+//	the slot is now dirty.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Release(int slot, bool changed)
+{
+    lock->Acquire();
+    slots[slot].busy = FALSE;
+    slots[slot].writingBack = -1;
+    if (changed) {
+	slots[slot].dirty = TRUE;
+	dirtied->Signal(lock);
+    }
+    slotFree->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector, BufferCache::WriteSector
+// 	Read or write the contents of "sector" through the cache.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sector, char *data)
+{
+    ReadSectors(sector, 1, data);
+}
+
+void
+BufferCache::WriteSector(int sector, char *data)
+{
+    WriteSectors(sector, 1, data);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadMisses
+// 	"firstSlot" has been grabbed for sector "first", which missed.
+//	Grab as many of the following "count" - 1 sectors as are missing
+//	too and can get a slot without waiting, read them all from the
+//	disk as one request into "data", and fill in their slots.
+//	Returns how many sectors were read.
+//----------------------------------------------------------------------
+
+int
+BufferCache::ReadMisses(int first, int count, int firstSlot, char *data)
+{
+    int runSlots[NumCacheSlots / 2];
+    int i, run = 1, slot;
+    bool hit;
+
+    runSlots[0] = firstSlot;
+    while ((run < count) && (run < NumCacheSlots / 2)
+	    && ((slot = Grab(first + run, &hit, FALSE)) != -1))
+	runSlots[run++] = slot;
+    synchDisk->ReadSectors(first, run, data);
+    for (i = 0; i < run; i++) {
+	bcopy(&data[i * SectorSize], slots[runSlots[i]].data, SectorSize);
+	Release(runSlots[i], FALSE);
+    }
+    return run;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSectors
+// 	Read "count" consecutive sectors starting at "first" into "data".
+//	Each miss takes the following misses with it, as one request.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSectors(int first, int count, char *data)
+{
+    int i, run, slot;
+    bool hit;
+
+    for (i = 0; i < count; i += run) {
+	slot = Grab(first + i, &hit, TRUE);
+	if (hit) {
+	    bcopy(slots[slot].data, &data[i * SectorSize], SectorSize);
+	    Release(slot, FALSE);
+	    run = 1;
+	} else {
+	    run = ReadMisses(first + i, count - i, slot, &data[i * SectorSize]);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Prefetch
+// 	Ask the read-ahead daemon to bring "count" consecutive sectors
+//	starting at "first" into the cache, and return at once.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Prefetch(int first, int count)
+{
+    Prefetching *run = new Prefetching;
+
+    if (reader == NULL) {
+	reader = new Thread("read ahead", MIN_NICE_PRIORITY, TRUE);
+	reader->Fork(ReadAheadThread, (int)this);
+    }
+    DEBUG('f', "Prefetching %d sectors at %d\n", count, first);
+    run->first = first;
+    run->count = count;
+    prefetches->Append((void *)run);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSectors
+// 	Write "count" consecutive sectors starting at "first" from
+//	"data".  Only the cache is changed; the first write starts the
+//	flush daemon.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSectors(int first, int count, char *data)
+{
+    int i, slot;
+    bool hit;
+
+    if (flusher == NULL) {
+	flusher = new Thread("cache flush", MIN_NICE_PRIORITY, TRUE);
+	flusher->Fork(FlushThread, (int)this);
+    }
+    for (i = 0; i < count; i++) {
+	slot = Grab(first + i, &hit, TRUE);
+	bcopy(&data[i * SectorSize], slots[slot].data, SectorSize);
+	Release(slot, TRUE);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flush
+// 	Write every dirty sector back to disk, in sector order, each run
+//	of consecutive sectors as one request.  A slot that is busy is
+//	skipped; whoever has it will have it written back later.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Flush()
+{
+    int order[NumCacheSlots];
+    char *buffer = new char[NumCacheSlots * SectorSize];
+    int i, j, run, count = 0;
+
+    lock->Acquire();
+    for (i = 0; i < NumCacheSlots; i++) {
+	if (!slots[i].dirty || slots[i].busy)
+	    continue;
+	slots[i].busy = TRUE;
+	for (j = count; (j > 0) && (slots[order[j - 1]].sector > slots[i].sector);
+		j--)
+	    order[j] = order[j - 1];
+	order[j] = i;
+	count++;
+    }
+    lock->Release();
+
+    DEBUG('f', "Buffer cache flushing %d sectors\n", count);
+    for (i = 0; i < count; i += run) {
+	for (run = 1; (i + run < count) && (slots[order[i + run]].sector
+			== slots[order[i]].sector + run); run++)
+	    ;
+	for (j = 0; j < run; j++)
+	    bcopy(slots[order[i + j]].data, &buffer[j * SectorSize],
+			SectorSize);
+	synchDisk->WriteSectors(slots[order[i]].sector, run, buffer);
+    }
+
+    lock->Acquire();
+    for (i = 0; i < count; i++) {
+	slots[order[i]].dirty = FALSE;
+	slots[order[i]].busy = FALSE;
+    }
+    slotFree->Broadcast(lock);
+    lock->Release();
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::FlushDaemon
+// 	The body of the flush daemon: so that a crash loses no more than
+//	FlushInterval ticks of changes, write back the dirty sectors
+//	every so often.  While the cache is clean the daemon waits for a
+//	write with no timeout pending, so that an idle Nachos can halt.
+//----------------------------------------------------------------------
+
+void
+BufferCache::FlushDaemon()
+{
+    for (;;) {
+	lock->Acquire();
+	while (!Dirty())
+	    dirtied->Wait(lock);
+	lock->Release();
+	timeouts->SleepUntil(stats->totalTicks + FlushInterval);
+	Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAheadDaemon
+// 	The body of the read-ahead daemon: read in the sectors asked for
+//	by Prefetch.  Those that are in the cache already, or busy (the
+//	reader got to them first), are left alone.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadAheadDaemon()
+{
+    Prefetching *run;
+    char *buffer = new char[(NumCacheSlots / 2) * SectorSize];
+    int i, done, slot;
+    bool hit;
+
+    for (;;) {
+	run = (Prefetching *)prefetches->Remove();
+	for (i = 0; i < run->count; i += done) {
+	    slot = Grab(run->first + i, &hit, FALSE);
+	    if (slot == -1)
+		done = 1;
+	    else
+		done = ReadMisses(run->first + i, run->count - i, slot, buffer);
+	}
+	delete run;
+    }
+}
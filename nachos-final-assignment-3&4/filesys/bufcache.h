@@ -0,0 +1,102 @@
+// bufcache.h
+//	Data structures for the buffer cache -- copies of recently used
+//	disk sectors, kept in memory so that the file system does not go
+//	to the disk for every access.
+//
+//	Everything the file system reads or writes (file headers, the
+//	free map, directories and file data) goes through the cache.
+//	Writes only change the copy in the cache; a dirty sector reaches
+//	the disk when its slot is reused, or when the flush daemon wakes
+//	up, FlushInterval ticks after the cache became dirty, and writes
+//	back everything dirty.
+//	A slot is reused on a miss when every slot is full, least
+//	recently used first.
+//
+//	Sectors can also be asked for ahead of time (Prefetch), for files
+//	being read sequentially; a read-ahead daemon brings them in while
+//	the reader goes on.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "synch.h"
+#include "synchlist.h"
+
+#define NumCacheSlots	64	// sectors the cache can hold
+#define FlushInterval	50000	// ticks between runs of the flush daemon
+
+// A sector in the cache.  While a slot is busy, one thread has it to
+// itself (to fill it from disk, copy in or out of it, or write it
+// back), and everybody else wanting it waits.
+
+class CacheSlot {
+  public:
+    int sector;				// the sector held, -1 if none
+    int writingBack;			// the sector this slot held before,
+					// while it is written back; -1 if none
+    bool dirty;				// changed since it was last written?
+    bool busy;				// a thread is using the slot
+    unsigned lastUse;			// when the slot was last used, for LRU
+    char data[SectorSize];
+};
+
+// The buffer cache.  ReadSector and WriteSector take the place of
+// SynchDisk's for the file system; they return once the data is in
+// the cache, which may mean waiting for the disk on a miss.
+
+class BufferCache {
+  public:
+    BufferCache();			// Initialize an empty cache
+    ~BufferCache();			// De-allocate it; call Flush first
+
+    void ReadSector(int sector, char *data);	// Read/write a sector
+    void WriteSector(int sector, char *data);	// through the cache
+    void ReadSectors(int first, int count, char *data);
+    void WriteSectors(int first, int count, char *data);
+					// Read/write consecutive sectors;
+					// the misses of a read go to the
+					// disk as runs
+
+    void Prefetch(int first, int count);	// Have consecutive sectors
+					// read in, without waiting for them
+
+    void Flush();			// Write back every dirty sector
+    void FlushDaemon();			// The flush daemon: Flush every
+					// FlushInterval ticks while anything
+					// is dirty, forever
+    void ReadAheadDaemon();		// The read-ahead daemon: serve
+					// Prefetch requests, forever
+
+  private:
+    CacheSlot slots[NumCacheSlots];
+    Lock *lock;				// protects the slots
+    Condition *slotFree;		// broadcast when a slot stops being
+					// busy
+    Condition *dirtied;			// signalled when a slot is dirtied,
+					// for the flush daemon
+    unsigned uses;			// counts uses of slots, for lastUse
+    Thread *flusher;			// the flush daemon, NULL until the
+					// first write
+    SynchList *prefetches;		// runs waiting for the read-ahead
+					// daemon
+    Thread *reader;			// the read-ahead daemon, NULL until
+					// the first Prefetch
+
+    int Find(int sector);		// the slot holding "sector", or -1
+    bool WritingBack(int sector);	// is "sector" being written back?
+    bool Dirty();			// is any slot dirty?
+    int Victim();			// the LRU slot that is not busy
+    int Grab(int sector, bool *hit, bool mayWait);
+					// make a slot busy for "sector"
+    void Release(int slot, bool changed);	// done with a busy slot
+    int ReadMisses(int first, int count, int firstSlot, char *data);
+					// read a run of missing sectors
+};
+
+#endif // BUFCACHE_H
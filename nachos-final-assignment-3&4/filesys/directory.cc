@@ -7,14 +7,18 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is open addressed: a name hashes to an entry, and is
+//	kept there or in the first free entry after it (wrapping around).
+//	A removed name leaves its entry marked, so that searches for the
+//	names past it keep going; Add reuses such entries, and they are
+//	dropped when the table is rebuilt.
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
-//
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	Once the table is three quarters full, counting removed entries,
+//	Add rebuilds it twice as big (or as big, if enough of it was
+//	removed entries), and the directory file has to grow with it.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -32,15 +36,14 @@
 //	is all we need, but otherwise, we need to call FetchFrom in order
 //	to initialize it from disk.
 //
-//	"size" is the number of entries in the directory
+//	"size" is the number of entries in the directory, a power of 2
 //----------------------------------------------------------------------
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    table = NULL;
+    tableSize = 0;
+    Rehash(size);
 }
 
 //----------------------------------------------------------------------
@@ -55,7 +58,8 @@ Directory::~Directory()
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table is as
+//	big as the file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -63,12 +67,29 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / sizeof(DirectoryEntry);
+
+    ASSERT((size > 0) && ((size & (size - 1)) == 0));
+    if (size != tableSize) {
+	delete [] table;
+	table = new DirectoryEntry[size];
+	tableSize = size;
+    }
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numInUse = numRemoved = 0;
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    numInUse++;
+	else if (table[i].removed)
+	    numRemoved++;
+    firstChanged = lastChanged = -1;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  Only
+//	the entries changed since the directory was last fetched or
+//	written go out.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -76,13 +97,107 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    ASSERT(file->Length() >= Size());
+    if (firstChanged == -1)
+	return;
+    (void) file->WriteAt((char *)&table[firstChanged],
+		(lastChanged - firstChanged + 1) * sizeof(DirectoryEntry),
+		firstChanged * sizeof(DirectoryEntry));
+    firstChanged = lastChanged = -1;
+}
+
+//----------------------------------------------------------------------
+// Directory::Size
+// 	Return the number of bytes the table takes on disk.
+//----------------------------------------------------------------------
+
+int
+Directory::Size()
+{
+    return tableSize * sizeof(DirectoryEntry);
+}
+
+//----------------------------------------------------------------------
+// Directory::Slot
+// 	Return the entry where a search for "name" starts: a hash of
+//	the name (FNV-1a, over the characters that are kept).
+//
+//	"name" -- the file name to hash
+//----------------------------------------------------------------------
+
+int
+Directory::Slot(char *name)
+{
+    unsigned int hash = 2166136261U;
+
+    for (int i = 0; (i < FileNameMaxLen) && (name[i] != '\0'); i++) {
+	hash ^= (unsigned char) name[i];
+	hash *= 16777619U;
+    }
+    return hash & (tableSize - 1);
+}
+
+//----------------------------------------------------------------------
+// Directory::Changed
+// 	Note that entries "first" through "last" need writing back.
+//----------------------------------------------------------------------
+
+void
+Directory::Changed(int first, int last)
+{
+    if (firstChanged == -1) {
+	firstChanged = first;
+	lastChanged = last;
+    } else {
+	firstChanged = min(firstChanged, first);
+	lastChanged = max(lastChanged, last);
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::Rehash
+// 	Rebuild the table with "size" entries, putting every name in use
+//	where it now hashes to, and dropping the removed entries.  The
+//	whole table needs writing back.
+//
+//	"size" -- the number of entries, a power of 2
+//----------------------------------------------------------------------
+
+void
+Directory::Rehash(int size)
+{
+    DirectoryEntry *old = table;
+    int oldSize = tableSize;
+    int i, j;
+
+    ASSERT((size > 0) && ((size & (size - 1)) == 0));
+    table = new DirectoryEntry[size];
+    tableSize = size;
+    for (i = 0; i < tableSize; i++) {
+	table[i].inUse = table[i].removed = FALSE;
+	table[i].sector = -1;
+	bzero(table[i].name, FileNameMaxLen + 1);
+    }
+    numInUse = numRemoved = 0;
+    if (old != NULL) {
+	for (i = 0; i < oldSize; i++)
+	    if (old[i].inUse) {
+		for (j = Slot(old[i].name); table[j].inUse;
+			j = (j + 1) & (tableSize - 1))
+		    ;
+		table[j] = old[i];
+		numInUse++;
+	    }
+	delete [] old;
+    }
+    Changed(0, tableSize - 1);
 }
 
 //----------------------------------------------------------------------
 // Directory::FindIndex
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
+//	The search stops at the first entry that has never been used.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
@@ -90,9 +205,15 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    int i = Slot(name);
+
+    for (int probes = 0; probes < tableSize; probes++) {
+	if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
+	if (!table[i].inUse && !table[i].removed)
+	    break;
+	i = (i + 1) & (tableSize - 1);
+    }
     return -1;		// name not in directory
 }
 
@@ -118,9 +239,9 @@ Directory::Find(char *name)
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory.
+//	If the table is getting full, it is rebuilt first; the caller
+//	must then grow the directory file to Size() before WriteBack.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
@@ -129,17 +250,24 @@ Directory::Find(char *name)
 bool
 Directory::Add(char *name, int newSector)
 { 
+    int i;
+
     if (FindIndex(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    if ((numInUse + numRemoved + 1) * 4 > tableSize * 3)
+	Rehash(((numInUse + 1) * 2 > tableSize) ? 2 * tableSize : tableSize);
+    for (i = Slot(name); table[i].inUse; i = (i + 1) & (tableSize - 1))
+	;
+    if (table[i].removed)
+	numRemoved--;
+    table[i].inUse = TRUE;
+    table[i].removed = FALSE;
+    strncpy(table[i].name, name, FileNameMaxLen); 
+    table[i].sector = newSector;
+    numInUse++;
+    Changed(i, i);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -158,6 +286,10 @@ Directory::Remove(char *name)
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    table[i].removed = TRUE;
+    numInUse--;
+    numRemoved++;
+    Changed(i, i);
     return TRUE;	
 }
 
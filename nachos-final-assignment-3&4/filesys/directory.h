@@ -6,6 +6,11 @@
 //	where to find its file header (the data structure describing
 //	where to find the file's data blocks) on disk.
 //
+//	The table is a hash table, on disk as in memory: a name is kept
+//	in the first free entry at or after the one its hash picks, so
+//	that looking it up or adding it takes O(1) probes on average.
+//	The table doubles when it gets three quarters full.
+//
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -19,8 +24,8 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		23	// for simplicity, we assume 
+					// file names are <= 23 characters long
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +37,8 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool removed;			// Was it in use, until its file was
+					// removed?  Lookups go past it
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -42,21 +49,25 @@ class DirectoryEntry {
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, as long
+// as the table.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  WriteBack only writes the entries changed since the
+// directory was last fetched or written; if the table has grown, the
+// caller must first extend the file to Size() bytes.
 
 class Directory {
   public:
     Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+					// with "size" entries, a power of 2
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
+    int Size();				// Bytes the table takes on disk
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
@@ -75,9 +86,17 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int numInUse;			// Entries in use
+    int numRemoved;			// Entries marked removed
+    int firstChanged, lastChanged;	// Range of entries not yet written
+					// back, -1 if none
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    int Slot(char *name);		// Where a search for "name" starts
+    void Changed(int first, int last);	// Entries to write back
+    void Rehash(int size);		// Rebuild the table with "size"
+					// entries, dropping removed ones
 };
 
 #endif // DIRECTORY_H
@@ -3,12 +3,11 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a table of
+//	pointers -- each entry in the table points to the disk sector
+//	containing that portion of the file data.  The first entries are
+//	in the header, which is just big enough to fit in one disk
+//	sector; the rest are in single and doubly indirect blocks.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,33 +26,226 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FetchIndex
+// 	Return a new copy of the index block in "sector".
+//----------------------------------------------------------------------
+
+static int *
+FetchIndex(int sector)
+{
+    int *block = new int[NumIndirect];
+
+    ASSERT(sector >= 0);
+    bufferCache->ReadSector(sector, (char *)block);
+    return block;
+}
+
+//----------------------------------------------------------------------
+// CachedIndex
+// 	Return the index block in "sector", reading it into "*cached"
+//	if it is not there yet.  The read may sleep, and another thread
+//	using the same header may read the block meanwhile; the first
+//	copy in is kept, the other dropped.
+//----------------------------------------------------------------------
+
+static int *
+CachedIndex(int **cached, int sector)
+{
+    int *block;
+
+    if (*cached == NULL) {
+	block = FetchIndex(sector);
+	if (*cached == NULL)
+	    *cached = block;
+	else
+	    delete [] block;
+    }
+    return *cached;
+}
+
+//----------------------------------------------------------------------
+// EmptyIndex
+// 	Return a new index block that points nowhere.
+//----------------------------------------------------------------------
+
+static int *
+EmptyIndex()
+{
+    int *block = new int[NumIndirect];
+
+    for (int i = 0; i < NumIndirect; i++)
+	block[i] = -1;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// IndexSectors
+// 	How many index blocks a file of "numSectors" data sectors needs.
+//----------------------------------------------------------------------
+
+static int
+IndexSectors(int numSectors)
+{
+    int beyond = numSectors - NumDirect - NumIndirect;
+
+    if (numSectors <= (int) NumDirect)
+	return 0;
+    if (beyond <= 0)
+	return 1;
+    return 2 + divRoundUp(beyond, NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader, FileHeader::~FileHeader
+// 	The index blocks are only read when ByteToSector needs them.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = numSectors = 0;
+    indirect = doubleIndirect = -1;
+    indirectBlock = doubleBlock = secondBlock = NULL;
+    secondIndex = -1;
+}
+
+FileHeader::~FileHeader()
+{
+    ForgetIndex();
+}
+
+void
+FileHeader::ForgetIndex()
+{
+    delete [] indirectBlock;
+    delete [] doubleBlock;
+    delete [] secondBlock;
+    indirectBlock = doubleBlock = secondBlock = NULL;
+    secondIndex = -1;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk
+//	blocks, and the index blocks needed to find them; the index
+//	blocks are written out here, the header is up to the caller.
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the new file
 //----------------------------------------------------------------------
 
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    ForgetIndex();
+    numBytes = numSectors = 0;
+    for (int i = 0; i < (int) NumDirect; i++)
+	dataSectors[i] = -1;
+    indirect = doubleIndirect = -1;
+    return Extend(freeMap, fileSize);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newSize" bytes, allocating the data blocks it
+//	needs beyond those it has, and any new index blocks.  The index
+//	blocks are written out here, the header is up to the caller.
+//	Return FALSE, changing nothing, if there are not enough free
+//	blocks.  A file is never shrunk.
+//
+//	The blocks are taken in extents, runs of consecutive free sectors
+//	that stay within a track when they can (BitMap::FindRun), so
+//	that the file can be read with few seeks.  The new index blocks
+//	come first, so the new data is all in one run if the space allows.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the number of bytes the file is to have
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int newSize)
+{
+    int newSectors = divRoundUp(newSize, SectorSize);
+    int i, j, first, length, total, numIndex, next, used, second, end;
+    int *sectors, *block;
+
+    if (newSectors <= numSectors) {
+	numBytes = max(numBytes, newSize);
+	return TRUE;
+    }
+    numIndex = IndexSectors(newSectors) - IndexSectors(numSectors);
+    total = newSectors - numSectors + numIndex;
+    if ((newSectors > (int) MaxFileSectors) || (freeMap->NumClear() < total))
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+    sectors = new int[total];
+    for (i = 0; i < total; i += length) {
+	first = freeMap->FindRun(total - i, SectorsPerTrack, &length);
+	ASSERT(first != -1);
+	for (j = 0; j < length; j++)
+	    sectors[i + j] = first + j;
+    }
+    used = 0;				// index blocks handed out
+    next = numIndex;			// the next data sector to hand out
+
+    for (i = numSectors; (i < newSectors) && (i < (int) NumDirect); i++)
+	dataSectors[i] = sectors[next++];
+
+    if ((newSectors > (int) NumDirect)
+		&& (numSectors < (int) NumDirect + NumIndirect)) {
+	if (indirect == -1) {
+	    indirect = sectors[used++];
+	    indirectBlock = EmptyIndex();
+	} else
+	    CachedIndex(&indirectBlock, indirect);
+	for (i = max(numSectors, (int) NumDirect);
+		(i < newSectors) && (i < (int) NumDirect + NumIndirect); i++)
+	    indirectBlock[i - (int) NumDirect] = sectors[next++];
+	bufferCache->WriteSector(indirect, (char *)indirectBlock);
+    }
+
+    if (newSectors > (int) NumDirect + NumIndirect) {
+	if (doubleIndirect == -1) {
+	    doubleIndirect = sectors[used++];
+	    doubleBlock = EmptyIndex();
+	} else
+	    CachedIndex(&doubleBlock, doubleIndirect);
+	for (i = max(numSectors, (int) NumDirect + NumIndirect); i < newSectors;
+		i = end) {
+	    second = (i - (int) NumDirect - NumIndirect) / NumIndirect;
+	    end = min(newSectors,
+			(int) NumDirect + NumIndirect + (second + 1) * NumIndirect);
+	    if (doubleBlock[second] == -1) {
+		doubleBlock[second] = sectors[used++];
+		block = EmptyIndex();
+	    } else
+		block = FetchIndex(doubleBlock[second]);
+	    for (j = i; j < end; j++)
+		block[(j - (int) NumDirect - NumIndirect) % NumIndirect] =
+							sectors[next++];
+	    bufferCache->WriteSector(doubleBlock[second], (char *)block);
+	    delete [] block;
+	}
+	bufferCache->WriteSector(doubleIndirect, (char *)doubleBlock);
+	delete [] secondBlock;		// may be out of date now
+	secondBlock = NULL;
+	secondIndex = -1;
+    }
+
+    ASSERT((used == numIndex) && (next == total));
+    delete [] sectors;
+    numSectors = newSectors;
+    numBytes = newSize;
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the index blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -61,9 +253,20 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int i, sector;
+
+    for (i = 0; i < numSectors; i++) {
+	sector = ByteToSector(i * SectorSize);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (indirect != -1)
+	freeMap->Clear(indirect);
+    if (doubleIndirect != -1) {
+	CachedIndex(&doubleBlock, doubleIndirect);
+	for (i = 0; (i < NumIndirect) && (doubleBlock[i] != -1); i++)
+	    freeMap->Clear(doubleBlock[i]);
+	freeMap->Clear(doubleIndirect);
     }
 }
 
@@ -77,7 +280,8 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    ForgetIndex();
+    bufferCache->ReadSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
@@ -90,7 +294,7 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    bufferCache->WriteSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
@@ -101,12 +305,59 @@ FileHeader::WriteBack(int sector)
 //	data at the offset is stored).
 //
 //	"offset" is the location within the file of the byte in question
+//
+//	This takes constant time: at most one index block is read, and
+//	it is kept for next time.
 //----------------------------------------------------------------------
 
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int index = offset / SectorSize;
+    int second, *block;
+
+    if (index < (int) NumDirect)
+	return(dataSectors[index]);
+
+    index -= NumDirect;
+    if (index < NumIndirect)
+	return(CachedIndex(&indirectBlock, indirect)[index]);
+
+    index -= NumIndirect;
+    ASSERT(index < NumIndirect * NumIndirect);
+    second = index / NumIndirect;
+    if (secondIndex != second) {
+	// read into a local first: another thread may use secondBlock
+	// while this one sleeps on the disk
+	block = FetchIndex(CachedIndex(&doubleBlock, doubleIndirect)[second]);
+	delete [] secondBlock;
+	secondBlock = block;
+	secondIndex = second;
+	return(block[index % NumIndirect]);
+    }
+    return(secondBlock[index % NumIndirect]);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extent
+// 	Return the disk sector holding byte "offset" of the file, and set
+//	"*length" to the number of sectors from there that follow it
+//	consecutively on disk, counting at most "maxSectors".  This is
+//	how the file's extents are seen: a reader can transfer each one
+//	as a single request.
+//----------------------------------------------------------------------
+
+int
+FileHeader::Extent(int offset, int maxSectors, int *length)
+{
+    int first = ByteToSector(offset);
+    int n;
+
+    for (n = 1; (n < maxSectors)
+	    && (ByteToSector(offset + n * SectorSize) == first + n); n++)
+	;
+    *length = n;
+    return first;
 }
 
 //----------------------------------------------------------------------
@@ -134,10 +385,14 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", ByteToSector(i * SectorSize));
+    if (indirect != -1)
+	printf("\nIndirect block: %d", indirect);
+    if (doubleIndirect != -1)
+	printf("\nDoubly indirect block: %d", doubleIndirect);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+	bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
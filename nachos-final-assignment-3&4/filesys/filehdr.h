@@ -17,29 +17,42 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	((SectorSize - 4 * sizeof(int)) / sizeof(int))
+#define NumIndirect	((int)(SectorSize / sizeof(int)))
+					// sector numbers in an index block
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// as in UNIX: the first NumDirect are in the header itself, the next
+// NumIndirect are in a single indirect block, and the rest are in
+// second-level blocks, found through a doubly indirect block.  An index
+// block is a sector full of sector numbers.  That is enough for a file
+// to span the whole disk.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the fields that are on disk to be the
+// same as one disk sector; they must come first.  In memory, the
+// header also keeps the index blocks ByteToSector has needed, so that
+// it does not read them again.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header is initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
+    FileHeader();			// An empty header, with no index
+					// blocks in memory
+    ~FileHeader();			// De-allocate the in-memory header
+
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Extend(BitMap *bitMap, int newSize);	// Grow the file, allocating
+						//  space for the new data
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
@@ -50,6 +63,10 @@ class FileHeader {
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
 					// the byte
+    int Extent(int offset, int maxSectors, int *length);
+					// The sector holding "offset", and
+					// how many sectors from there on are
+					// consecutive on disk
 
     int FileLength();			// Return the length of the file 
 					// in bytes
@@ -61,6 +78,18 @@ class FileHeader {
     int numSectors;			// Number of data sectors in the file
     int dataSectors[NumDirect];		// Disk sector numbers for each data 
 					// block in the file
+    int indirect;			// Sector of the single indirect block,
+					// -1 if the file does not need one
+    int doubleIndirect;			// Sector of the doubly indirect block,
+					// -1 if none
+
+    // Not on disk: index blocks read so far, NULL until needed
+    int *indirectBlock;			// the contents of "indirect"
+    int *doubleBlock;			// the contents of "doubleIndirect"
+    int *secondBlock;			// the last second-level block used,
+    int secondIndex;			// which is doubleBlock[secondIndex]
+
+    void ForgetIndex();			// Drop the index blocks in memory
 };
 
 #endif // FILEHDR_H
@@ -21,20 +21,26 @@
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
+//	The directory is also kept in memory, read once when the file
+//	system is initialized, so that looking a name up does not read
+//	the directory file.
+//
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
 //	are written immediately back to disk (the two files are kept
 //	open during all this time).  If the operation fails, and we have
 //	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	the changed version, without writing it back to disk, and read
+//	the directory back from its file.
+//
+//	Operations are serialized by a lock, since they may sleep on the
+//	disk while they share the directory in memory.
+//
+//	A file grows when it is written past its end (Extend).
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
+//	   there is no hierarchical directory structure
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -46,6 +52,7 @@
 #include "copyright.h"
 
 #include "disk.h"
+#include "synch.h"
 #include "bitmap.h"
 #include "directory.h"
 #include "filehdr.h"
@@ -57,11 +64,10 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directory; the directory file
+// grows as files are added.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
+#define NumDirEntries 		16	// a power of 2
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
@@ -80,9 +86,10 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    lock = new Lock("file system");
+    directory = new Directory(NumDirEntries);
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
@@ -130,7 +137,6 @@ FileSystem::FileSystem(bool format)
 	    directory->Print();
 
         delete freeMap; 
-	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
 	}
@@ -139,6 +145,7 @@ FileSystem::FileSystem(bool format)
     // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+	directory->FetchFrom(directoryFile);
     }
 }
 
@@ -161,11 +168,8 @@ FileSystem::FileSystem(bool format)
 // 	Create fails if:
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
-//
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+//	 	no free space to grow the directory, if it is full
 //
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
@@ -174,7 +178,6 @@ FileSystem::FileSystem(bool format)
 bool
 FileSystem::Create(char *name, int initialSize)
 {
-    Directory *directory;
     BitMap *freeMap;
     FileHeader *hdr;
     int sector;
@@ -182,9 +185,7 @@ FileSystem::Create(char *name, int initialSize)
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
+    lock->Acquire();
     if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
     else {	
@@ -199,6 +200,8 @@ FileSystem::Create(char *name, int initialSize)
     	    hdr = new FileHeader;
 	    if (!hdr->Allocate(freeMap, initialSize))
             	success = FALSE;	// no space on disk for data
+	    else if (!directoryFile->Extend(freeMap, directory->Size()))
+		success = FALSE;	// no space to grow the directory
 	    else {	
 	    	success = TRUE;
 		// everthing worked, flush all changes back to disk
@@ -208,9 +211,11 @@ FileSystem::Create(char *name, int initialSize)
 	    }
             delete hdr;
 	}
+	if (!success)
+	    directory->FetchFrom(directoryFile);	// undo the Add
         delete freeMap;
     }
-    delete directory;
+    lock->Release();
     return success;
 }
 
@@ -227,16 +232,15 @@ FileSystem::Create(char *name, int initialSize)
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
     sector = directory->Find(name); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    lock->Release();
     return openFile;				// return NULL if not found
 }
 
@@ -257,16 +261,14 @@ FileSystem::Open(char *name)
 bool
 FileSystem::Remove(char *name)
 { 
-    Directory *directory;
     BitMap *freeMap;
     FileHeader *fileHdr;
     int sector;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
     sector = directory->Find(name);
     if (sector == -1) {
-       delete directory;
+       lock->Release();
        return FALSE;			 // file not found 
     }
     fileHdr = new FileHeader;
@@ -282,11 +284,39 @@ FileSystem::Remove(char *name)
     freeMap->WriteBack(freeMapFile);		// flush to disk
     directory->WriteBack(directoryFile);        // flush to disk
     delete fileHdr;
-    delete directory;
     delete freeMap;
+    lock->Release();
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Grow an open file to "newSize" bytes, allocating its new blocks
+//	out of the free map.  Return FALSE if there is not enough free
+//	space; the file is then left as it was.
+//
+//	"file" -- the file to grow
+//	"newSize" -- the number of bytes it is to have
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(OpenFile *file, int newSize)
+{
+    BitMap *freeMap;
+    bool success;
+
+    DEBUG('f', "Extending a file to %d bytes\n", newSize);
+    lock->Acquire();
+    freeMap = new BitMap(NumSectors);
+    freeMap->FetchFrom(freeMapFile);
+    success = file->Extend(freeMap, newSize);
+    if (success)
+	freeMap->WriteBack(freeMapFile);	// flush to disk
+    delete freeMap;
+    lock->Release();
+    return success;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
 // 	List all the files in the file system directory.
@@ -295,11 +325,9 @@ FileSystem::Remove(char *name)
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
     directory->List();
-    delete directory;
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -318,7 +346,6 @@ FileSystem::Print()
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
     BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -331,11 +358,9 @@ FileSystem::Print()
     freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
 
     delete bitHdr;
     delete dirHdr;
     delete freeMap;
-    delete directory;
 } 
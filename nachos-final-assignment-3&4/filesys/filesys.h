@@ -65,6 +65,9 @@ class FileSystem {
 };
 
 #else // FILESYS
+class Directory;
+class Lock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -81,6 +84,10 @@ class FileSystem {
 
     bool Remove(char *name);  		// Delete a file (UNIX unlink)
 
+    bool Extend(OpenFile *file, int newSize);
+					// Grow an open file, for a write
+					// past its end
+
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
@@ -90,6 +97,9 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   Directory* directory;		// The root directory, as last
+					// written back, kept in memory
+   Lock* lock;				// One operation at a time
 };
 
 #endif // FILESYS
@@ -28,7 +28,11 @@ OpenFile::OpenFile(int sector)
 { 
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    nextPosition = 0;
+    readAhead = 0;
+    prefetched = 0;
 }
 
 //----------------------------------------------------------------------
@@ -84,6 +88,61 @@ OpenFile::Write(char *into, int numBytes)
    return result;
 }
 
+//----------------------------------------------------------------------
+// TransferSectors
+// 	Read or write sectors "firstSector" through "lastSector" of the
+//	file whose header is "hdr", into or from "buf", through the
+//	buffer cache.  Each run of them that is consecutive on disk is
+//	handed to the cache at once, so its misses are read together.
+//----------------------------------------------------------------------
+
+static void
+TransferSectors(FileHeader *hdr, int firstSector, int lastSector, char *buf,
+		bool writing)
+{
+    int i, start, run;
+
+    for (i = firstSector; i <= lastSector; i += run) {
+	start = hdr->Extent(i * SectorSize, lastSector - i + 1, &run);
+	if (writing)
+	    bufferCache->WriteSectors(start, run,
+					&buf[(i - firstSector) * SectorSize]);
+	else
+	    bufferCache->ReadSectors(start, run,
+					&buf[(i - firstSector) * SectorSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after a read that ended in file sector "lastSector".  If
+//	the reads have been sequential, ask the buffer cache for the next
+//	readAhead sectors, so the reader finds them in memory; the window
+//	doubles with each sequential read, up to MaxReadAhead.  A read
+//	anywhere else closes the window.
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int lastSector, bool sequential)
+{
+    int numSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int i, end, start, run;
+
+    if (!sequential) {
+	readAhead = prefetched = 0;
+	return;
+    }
+    readAhead = (readAhead == 0) ? MinReadAhead
+				 : min(2 * readAhead, MaxReadAhead);
+    i = max(lastSector + 1, prefetched);
+    end = min(lastSector + 1 + readAhead, numSectors);
+    for (; i < end; i += run) {
+	start = hdr->Extent(i * SectorSize, end - i, &run);
+	bufferCache->Prefetch(start, run);
+    }
+    prefetched = max(prefetched, end);
+}
+
 //----------------------------------------------------------------------
 // OpenFile::ReadAt/WriteAt
 // 	Read/write a portion of a file, starting at "position".
@@ -97,11 +156,16 @@ OpenFile::Write(char *into, int numBytes)
 //	For ReadAt:
 //	   We read in all of the full or partial sectors that are part of the
 //	   request, but we only copy the part we are interested in.
+//	   A read past the end of the file looks at the header on disk
+//	   first, in case the file has been grown through another open.
 //	For WriteAt:
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
 //	   or partial sectors that are part of the request.
+//	   A write past the end of the file grows it first, if there is
+//	   room on the disk (FileSystem::Extend); otherwise only what fits
+//	   is written.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -114,11 +178,29 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int firstSector, lastSector, numSectors;
+    FileHeader *current = hdr;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if (numBytes <= 0)
     	return 0; 				// check request
+    if ((position + numBytes) > fileLength) {
+	// our header may be out of date; read through the one on disk
+	// if it is longer, leaving ours to the next Extend
+	current = new FileHeader;
+	current->FetchFrom(hdrSector);
+	if (current->FileLength() > fileLength)
+	    fileLength = current->FileLength();
+	else {
+	    delete current;
+	    current = hdr;
+	}
+    }
+    if (position >= fileLength) {
+	if (current != hdr)
+	    delete current;
+	return 0;
+    }
     if ((position + numBytes) > fileLength)		
 	numBytes = fileLength - position;
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n", 	
@@ -130,9 +212,11 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    TransferSectors(current, firstSector, lastSector, buf, FALSE);
+    if (current != hdr)
+	delete current;
+    ReadAhead(lastSector, position == nextPosition);
+    nextPosition = position + numBytes;
 
     // copy the part we want
     bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
@@ -144,12 +228,18 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if (numBytes <= 0)
 	return 0;				// check request
+    if ((position + numBytes) > fileLength) {	// grow the file, if we can
+	(void) fileSystem->Extend(this, position + numBytes);
+	fileLength = hdr->FileLength();
+    }
+    if (position >= fileLength)
+	return 0;
     if ((position + numBytes) > fileLength)
 	numBytes = fileLength - position;
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
@@ -166,18 +256,16 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        TransferSectors(hdr, firstSector, firstSector, buf, FALSE);
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+        TransferSectors(hdr, lastSector, lastSector,
+			&buf[(lastSector - firstSector) * SectorSize], FALSE);
 
 // copy in the bytes we want to change 
     bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
 
 // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    TransferSectors(hdr, firstSector, lastSector, buf, TRUE);
     delete [] buf;
     return numBytes;
 }
@@ -192,3 +280,28 @@ OpenFile::Length()
 { 
     return hdr->FileLength(); 
 }
+
+//----------------------------------------------------------------------
+// OpenFile::Extend
+// 	Grow the file to "newSize" bytes, and write the changed header
+//	back to disk.  The caller writes back "freeMap".  Return FALSE
+//	if there is not enough free space.
+//
+//	Each open of a file has its own copy of the header, and another
+//	may have grown the file since this one was read; so the header
+//	is read again first.  The caller holds the file system lock,
+//	which keeps any other Extend out meanwhile.
+//
+//	"freeMap" -- the bit map of free disk sectors
+//	"newSize" -- the number of bytes the file is to have
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Extend(BitMap *freeMap, int newSize)
+{
+    hdr->FetchFrom(hdrSector);
+    if (!hdr->Extend(freeMap, newSize))
+	return FALSE;
+    hdr->WriteBack(hdrSector);
+    return TRUE;
+}
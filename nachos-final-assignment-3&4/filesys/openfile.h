@@ -60,6 +60,10 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class BitMap;
+
+#define MinReadAhead	2	// sectors read ahead of a sequential read,
+#define MaxReadAhead	16	// growing from the first to the second
 
 class OpenFile {
   public:
@@ -86,9 +90,22 @@ class OpenFile {
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
     
+    bool Extend(BitMap *freeMap, int newSize);
+					// Grow the file to "newSize" bytes,
+					// taking blocks from "freeMap"
+    
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+
+    int nextPosition;			// Where a sequential read would start
+    int readAhead;			// Sectors to read ahead of a
+					// sequential read, 0 if not sequential
+    int prefetched;			// File sectors before this one have
+					// been asked for already
+
+    void ReadAhead(int lastSector, bool sequential);
 };
 
 #endif // FILESYS
@@ -5,10 +5,11 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request carries a semaphore, on which the thread that made
+//	it waits.  Because the physical disk can only handle one
+//	operation at a time, requests that arrive while it is busy are
+//	queued; the interrupt handler starts the next one as soon as the
+//	disk is done.  The queue is only touched with interrupts off.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +17,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,6 +33,31 @@ DiskRequestDone (int arg)
     disk->RequestDone();
 }
 
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Initialize a request for "count" sectors starting at "first",
+//	to be read into or written from "buffer".
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int first, int count, char *buffer, bool write,
+			Semaphore *whenDone)
+{
+    ASSERT(count > 0);
+    sector = first;
+    last = first + count - 1;
+    data = buffer;
+    writing = write;
+    arrival = 0;
+    done = whenDone;
+    next = NULL;
+}
+
+bool
+DiskRequest::Overlaps(DiskRequest *other)
+{
+    return (sector <= other->last) && (other->sector <= last);
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
@@ -38,13 +65,16 @@ DiskRequestDone (int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"tracks" -- size of the disk, in tracks
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int tracks)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
+    queue = active = NULL;
+    arrivals = 0;
+    headSector = 0;
+    ascending = TRUE;
+    disk = new Disk(name, DiskRequestDone, (int) this, tracks);
 }
 
 //----------------------------------------------------------------------
@@ -56,8 +86,6 @@ SynchDisk::SynchDisk(char* name)
 SynchDisk::~SynchDisk()
 {
     delete disk;
-    delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +100,7 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Transfer(sectorNumber, 1, data, FALSE);
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +115,222 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Transfer(sectorNumber, 1, data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors, SynchDisk::WriteSectors
+// 	Read or write "count" consecutive sectors starting at "first",
+//	as a single request.  Return only once all of them are done.
+//
+//	"data" -- the buffer, "count" sectors long
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int first, int count, char *data)
+{
+    Transfer(first, count, data, FALSE);
+}
+
+void
+SynchDisk::WriteSectors(int first, int count, char *data)
+{
+    Transfer(first, count, data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Transfer
+// 	Queue a request, start it if the disk is idle, and wait until
+//	the interrupt handler says it is done.  The request and its
+//	semaphore live on our stack.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Transfer(int first, int count, char *data, bool writing)
+{
+    Semaphore done("disk request", 0);
+    DiskRequest request(first, count, data, writing, &done);
+    DiskRequest **end;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    DEBUG('d', "Queueing %s of %d sectors at %d\n",
+		writing ? "write" : "read", count, first);
+    request.arrival = arrivals++;
+    for (end = &queue; *end != NULL; end = &(*end)->next)
+	;
+    *end = &request;
+    if (active == NULL)
+	Dispatch(Choose());
+    (void) interrupt->SetLevel(oldLevel);
+
+    done.P();				// wait for the last interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MayStart
+// 	A request may not be served before an earlier one for any of the
+//	same sectors, unless both are reads: a read must see the writes
+//	made before it, and none of those made after it.
+//----------------------------------------------------------------------
+
+bool
+SynchDisk::MayStart(DiskRequest *request)
+{
+    DiskRequest *earlier;
+
+    for (earlier = queue; earlier != request; earlier = earlier->next)
+	if ((earlier->writing || request->writing)
+		&& earlier->Overlaps(request))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Choose
+// 	Return the request to serve next, by the algorithm in
+//	diskSchedAlgo, or NULL if there are none:
+//
+//	DISK_FCFS -- the oldest request
+//	DISK_SSTF -- the request closest to the head
+//	DISK_SCAN -- the closest one in the direction the head is moving;
+//	   if there is none the head turns around
+//	DISK_CLOOK -- the closest one above the head; if there is none
+//	   the head goes back to the lowest request
+//
+//	The oldest request may always start, so one is found whenever
+//	the queue is not empty.  Between requests as close, the older
+//	one wins.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Choose()
+{
+    DiskRequest *request, *nearest = NULL, *ahead = NULL, *behind = NULL;
+    DiskRequest *lowest = NULL;
+    int distance;
+
+    for (request = queue; request != NULL; request = request->next) {
+	if (!MayStart(request))
+	    continue;
+	if (diskSchedAlgo == DISK_FCFS)
+	    return request;
+
+	distance = request->sector - headSector;
+	if ((nearest == NULL)
+		|| (abs(distance) < abs(nearest->sector - headSector)))
+	    nearest = request;
+	if ((lowest == NULL) || (request->sector < lowest->sector))
+	    lowest = request;
+	if (ascending ? (distance >= 0) : (distance <= 0)) {
+	    if ((ahead == NULL)
+		    || (abs(distance) < abs(ahead->sector - headSector)))
+		ahead = request;
+	} else if ((behind == NULL)
+		    || (abs(distance) < abs(behind->sector - headSector))) {
+	    behind = request;
+	}
+    }
+
+    switch (diskSchedAlgo) {
+      case DISK_SSTF:
+	return nearest;
+      case DISK_SCAN:
+	if ((ahead == NULL) && (behind != NULL)) {
+	    ascending = !ascending;
+	    return behind;
+	}
+	return ahead;
+      case DISK_CLOOK:
+	return (ahead != NULL) ? ahead : lowest;
+      default:
+	ASSERT(FALSE);
+	return NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Dequeue
+// 	Take "request" off the queue of waiting requests.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Dequeue(DiskRequest *request)
+{
+    DiskRequest **link;
+
+    for (link = &queue; *link != request; link = &(*link)->next)
+	ASSERT(*link != NULL);
+    *link = request->next;
+    request->next = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Dispatch
+// 	Make "request" the one the disk is working on, and start it.
+//	Does nothing if "request" is NULL (the queue was empty).
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Dispatch(DiskRequest *request)
+{
+    if (request == NULL)
+	return;
+    Dequeue(request);
+    active = request;
+    stats->numDiskRequests++;
+    StartSector();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartSector
+// 	Send the disk the next sector of the active request, keeping
+//	count of how far the head had to move for it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartSector()
+{
+    stats->diskSeekTracks += abs(active->sector / SectorsPerTrack
+					- headSector / SectorsPerTrack);
+    headSector = active->sector;
+    if (active->writing)
+	disk->WriteRequest(active->sector, active->data);
+    else
+	disk->ReadRequest(active->sector, active->data);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Go on with the next sector of the active
+//	request, or if it is finished wake up the thread waiting for it
+//	and start the next request.  A waiting request of the same kind
+//	that takes up where the finished one left off goes first.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    DiskRequest *finished = active, *request;
+
+    if (finished->sector < finished->last) {
+	finished->sector++;
+	finished->data += SectorSize;
+	StartSector();
+	return;
+    }
+
+    active = NULL;
+    for (request = queue; request != NULL; request = request->next)
+	if ((request->writing == finished->writing)
+		&& (request->sector == finished->last + 1)
+		&& MayStart(request))
+	    break;
+    if (request != NULL)
+	stats->numDiskMerges++;
+    else
+	request = Choose();
+    Dispatch(request);
+
+    finished->done->V();		// the request is gone from our data
+					// structures; its owner may go on
 }
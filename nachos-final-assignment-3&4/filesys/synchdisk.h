@@ -14,6 +14,26 @@
 #include "disk.h"
 #include "synch.h"
 
+// A request for a run of consecutive sectors, all read or all written.
+// It lives on the stack of the thread that made it, which sleeps on
+// "done" until the whole run has been transferred.
+
+class DiskRequest {
+  public:
+    DiskRequest(int first, int count, char *buffer, bool write,
+		Semaphore *whenDone);
+
+    bool Overlaps(DiskRequest *other);	// do the two runs share a sector?
+
+    int sector;				// next sector to transfer
+    int last;				// last sector of the run
+    char *data;				// where "sector" is read or written
+    bool writing;			// write, rather than read, the run
+    unsigned arrival;			// order in which requests were made
+    Semaphore *done;			// signalled once the run is done
+    DiskRequest *next;			// next request waiting for the disk
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -23,10 +43,17 @@
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
+// returning.  Any number of threads may have requests outstanding; they
+// wait in a queue, and each time the disk finishes one, the next is
+// picked by the disk scheduling algorithm (diskSchedAlgo, cf. system.h).
+// A request for the sectors right after a run that just finished is
+// taken first, whatever the algorithm, so adjacent requests are served
+// as one run.  Requests that overlap are always served in the order
+// they were made.
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, int tracks = NumTracks);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
@@ -38,16 +65,32 @@ class SynchDisk {
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
     
+    void ReadSectors(int first, int count, char *data);
+    void WriteSectors(int first, int count, char *data);
+					// Read/write "count" consecutive
+					// sectors, as one request
+
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskRequest *queue;			// Requests waiting for the disk, in
+					// the order they were made
+    DiskRequest *active;		// The request the disk is working
+					// on, NULL if it is idle
+    unsigned arrivals;			// Counts requests, for "arrival"
+    int headSector;			// Sector of the last transfer
+    bool ascending;			// Direction of the head, for SCAN
+
+    void Transfer(int first, int count, char *data, bool writing);
+    bool MayStart(DiskRequest *request);	// no earlier request overlaps?
+    DiskRequest *Choose();		// The next request to serve
+    void Dequeue(DiskRequest *request);
+    void Dispatch(DiskRequest *request);	// Make "request" the active one
+    void StartSector();			// Send the disk the next sector of
+					// the active request
 };
 
 #endif // SYNCHDISK_H
@@ -53,6 +53,7 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     readHandler = readAvail;
     handlerArg = callArg;
     putBusy = FALSE;
+    putCount = 0;
     incoming = EOF;
 
     // start polling for incoming packets
@@ -114,7 +115,7 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putCount;
     (*writeHandler)(handlerArg);
 }
 
@@ -141,10 +142,25 @@ Console::GetChar()
 
 void
 Console::PutChar(char ch)
+{
+    PutChars(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// Console::PutChars()
+// 	Write "count" characters to the simulated display with one call
+//	to the host, and schedule the interrupt for when the device would
+//	have sent them one at a time: ConsoleTime for each character.
+//----------------------------------------------------------------------
+
+void
+Console::PutChars(char *from, int count)
 {
     ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    ASSERT(count > 0);
+    WriteFile(writeFileNo, from, count);
     putBusy = TRUE;
-    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
+    putCount = count;
+    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime * count,
 					ConsoleWriteInt);
 }
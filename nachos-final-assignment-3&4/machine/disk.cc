@@ -23,7 +23,7 @@
 #define MagicNumber 	0x456789ab
 #define MagicSize 	sizeof(int)
 
-#define DiskSize 	(MagicSize + (NumSectors * SectorSize))
+#define DiskSize 	(MagicSize + (numSectors * SectorSize))
 
 // dummy procedure because we can't take a pointer of a member function
 static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
@@ -38,9 +38,11 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes
 //	"callArg" -- argument to pass the interrupt handler
+//	"tracks" -- size of the disk; a swap disk is bigger than the
+//	   file system disk, but has the same geometry otherwise
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg, int tracks)
 {
     int magicNum;
     int tmp = 0;
@@ -48,6 +50,7 @@ Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
     DEBUG('d', "Initializing the disk, 0x%x 0x%x\n", callWhenDone, callArg);
     handler = callWhenDone;
     handlerArg = callArg;
+    numSectors = SectorsPerTrack * tracks;
     lastSector = 0;
     bufferInit = 0;
     
@@ -118,7 +121,7 @@ Disk::ReadRequest(int sectorNumber, char* data)
     int ticks = ComputeLatency(sectorNumber, FALSE);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
     
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
@@ -138,7 +141,7 @@ Disk::WriteRequest(int sectorNumber, char* data)
     int ticks = ComputeLatency(sectorNumber, TRUE);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
     
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
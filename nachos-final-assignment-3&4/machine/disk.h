@@ -54,8 +54,10 @@
 
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
-    					// Create a simulated disk.  
+    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg,
+	 int tracks = NumTracks);
+    					// Create a simulated disk with
+					// "tracks" tracks.
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
     ~Disk();				// Deallocate the disk.
@@ -77,6 +79,7 @@ class Disk {
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    int numSectors;			// # of sectors on this disk
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
     int handlerArg;			// Argument to interrupt handler 
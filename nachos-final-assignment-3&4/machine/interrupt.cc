@@ -20,6 +20,9 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
+#include <limits.h>
+#include <strings.h>
+
 #include "copyright.h"
 #include "interrupt.h"
 #include "system.h"
@@ -28,7 +31,7 @@
 
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv", "timeout"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -48,6 +51,298 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    next = prev = NULL;
+    slot = -1;
+}
+
+//----------------------------------------------------------------------
+// NextSet
+// 	Return the index of the first set bit at or after "from" in a
+//	bitmap of WheelSlots bits, -1 if there is none.
+//----------------------------------------------------------------------
+
+static int
+NextSet(unsigned int *bits, int from)
+{
+    unsigned int word;
+    int w;
+
+    for (w = from / 32; w < WheelSlots / 32; w++) {
+	word = bits[w];
+	if (w == from / 32)
+	    word &= ~0U << (from % 32);
+	if (word != 0)
+	    return w * 32 + ffs(word) - 1;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::TimerWheel
+// 	Initialize an empty timer wheel, at time 0.
+//----------------------------------------------------------------------
+
+TimerWheel::TimerWheel()
+{
+    int i, level;
+
+    for (i = 0; i <= OverflowSlot; i++)
+	head[i] = tail[i] = NULL;
+    for (level = 0; level < WheelLevels; level++)
+	for (i = 0; i < WheelSlots / 32; i++)
+	    occupied[level][i] = 0;
+    current = 0;
+    count = 0;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::~TimerWheel
+// 	De-allocate the interrupts that never fired.
+//----------------------------------------------------------------------
+
+TimerWheel::~TimerWheel()
+{
+    PendingInterrupt *pend;
+    int i;
+
+    for (i = 0; i <= OverflowSlot; i++) {
+	while ((pend = head[i]) != NULL) {
+	    head[i] = pend->next;
+	    delete pend;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::SlotFor
+// 	Return the slot an interrupt due at "when" belongs in now: the
+//	lowest level whose slots, taken together, reach that far ahead
+//	of the current time.
+//----------------------------------------------------------------------
+
+int
+TimerWheel::SlotFor(int when)
+{
+    int ahead = when - current;
+    int level;
+
+    ASSERT(ahead >= 0);
+    for (level = 0; level < WheelLevels; level++) {
+	if (ahead < (1 << (WheelBits * (level + 1))))
+	    return level * WheelSlots 
+		+ ((when >> (WheelBits * level)) & (WheelSlots - 1));
+    }
+    return OverflowSlot;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Link, TimerWheel::Unlink
+// 	Put an interrupt in the slot it belongs in, at the tail or (when
+//	cascading interrupts that were scheduled earlier) at the head;
+//	or take it out of its slot.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Link(PendingInterrupt *pend, bool atHead)
+{
+    int slot = SlotFor(pend->when);
+
+    pend->slot = slot;
+    if (head[slot] == NULL) {
+	pend->next = pend->prev = NULL;
+	head[slot] = tail[slot] = pend;
+	if (slot != OverflowSlot)
+	    occupied[slot / WheelSlots][(slot % WheelSlots) / 32] 
+						|= 1U << (slot % 32);
+    } else if (atHead) {
+	pend->prev = NULL;
+	pend->next = head[slot];
+	head[slot]->prev = pend;
+	head[slot] = pend;
+    } else {
+	pend->next = NULL;
+	pend->prev = tail[slot];
+	tail[slot]->next = pend;
+	tail[slot] = pend;
+    }
+}
+
+void
+TimerWheel::Unlink(PendingInterrupt *pend)
+{
+    int slot = pend->slot;
+
+    if (pend->prev == NULL)
+	head[slot] = pend->next;
+    else
+	pend->prev->next = pend->next;
+    if (pend->next == NULL)
+	tail[slot] = pend->prev;
+    else
+	pend->next->prev = pend->prev;
+    if ((head[slot] == NULL) && (slot != OverflowSlot))
+	occupied[slot / WheelSlots][(slot % WheelSlots) / 32] 
+						&= ~(1U << (slot % 32));
+    pend->next = pend->prev = NULL;
+    pend->slot = -1;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Cascade
+// 	The wheel has reached the start of "slot"; move its interrupts
+//	down to the levels below.  Anything already there for the same
+//	time was scheduled later, so these go in front, in their order.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Cascade(int slot)
+{
+    PendingInterrupt *pend = tail[slot];
+    PendingInterrupt *prev;
+
+    head[slot] = tail[slot] = NULL;
+    if (slot != OverflowSlot)
+	occupied[slot / WheelSlots][(slot % WheelSlots) / 32] 
+						&= ~(1U << (slot % 32));
+    for (; pend != NULL; pend = prev) {
+	prev = pend->prev;
+	Link(pend, TRUE);
+    }
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::NextStop
+// 	Return the next time after "current" at which the wheel has
+//	something to do: a level 0 slot with interrupts in it, or the
+//	start of a higher level slot that has to be cascaded.  Slots
+//	behind the current one of their level hold interrupts for its
+//	next turn, so for those the start of that turn will do.
+//----------------------------------------------------------------------
+
+int
+TimerWheel::NextStop()
+{
+    int best = INT_MAX;
+    int level, index, shift, candidate;
+
+    index = NextSet(occupied[0], (current & (WheelSlots - 1)) + 1);
+    if (index >= 0)
+	return (current & ~(WheelSlots - 1)) + index;
+
+    for (level = 0; level < WheelLevels; level++) {
+	shift = WheelBits * (level + 1);
+	index = -1;
+	if (level > 0)
+	    index = NextSet(occupied[level], 
+		((current >> (WheelBits * level)) & (WheelSlots - 1)) + 1);
+	if (index >= 0)
+	    candidate = ((current >> shift) << shift) 
+				+ (index << (WheelBits * level));
+	else if (NextSet(occupied[level], 0) >= 0)
+	    candidate = ((current >> shift) + 1) << shift;
+	else
+	    continue;
+	if (candidate < best)
+	    best = candidate;
+    }
+    if (head[OverflowSlot] != NULL) {
+	shift = WheelBits * WheelLevels;
+	candidate = ((current >> shift) + 1) << shift;
+	if (candidate < best)
+	    best = candidate;
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::Insert
+// 	Schedule "pend", in O(1).  An empty wheel is moved on to "now",
+//	so that it does not have to catch up later.
+//----------------------------------------------------------------------
+
+void
+TimerWheel::Insert(PendingInterrupt *pend, int now)
+{
+    if (count == 0)
+	current = now;
+    Link(pend, FALSE);
+    count++;
+}
+
+void
+TimerWheel::Remove(PendingInterrupt *pend)
+{
+    ASSERT(pend->slot >= 0);
+    Unlink(pend);
+    count--;
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::First
+// 	Move the wheel on, jumping from one non-empty slot to the next,
+//	until it reaches an interrupt or passes "limit".  Return the
+//	earliest interrupt, without taking it off the wheel, if it is
+//	due at or before "limit"; NULL otherwise.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+TimerWheel::First(int limit)
+{
+    int next, level;
+
+    if (count == 0)
+	return NULL;
+    for (;;) {
+	if (head[current & (WheelSlots - 1)] != NULL)
+	    break;
+	next = NextStop();
+	if (next > limit) {
+	    if (limit > current)
+		current = limit;
+	    return NULL;
+	}
+	current = next;
+	for (level = 1; level < WheelLevels; level++) {
+	    if ((current & ((1 << (WheelBits * level)) - 1)) != 0)
+		break;
+	    Cascade(level * WheelSlots 
+		+ ((current >> (WheelBits * level)) & (WheelSlots - 1)));
+	}
+	if ((level == WheelLevels) 
+	   && ((current & ((1 << (WheelBits * WheelLevels)) - 1)) == 0))
+	    Cascade(OverflowSlot);
+    }
+    if (current > limit)
+	return NULL;
+    return head[current & (WheelSlots - 1)];
+}
+
+//----------------------------------------------------------------------
+// TimerWheel::NextTime
+// 	Return a time before which no interrupt is due: exact if one is
+//	due within the current level 0 turn, otherwise the next time the
+//	wheel has to cascade, which is no later than the interrupt.
+//----------------------------------------------------------------------
+
+int
+TimerWheel::NextTime()
+{
+    if (count == 0)
+	return INT_MAX;
+    if (head[current & (WheelSlots - 1)] != NULL)
+	return current;
+    return NextStop();
+}
+
+void
+TimerWheel::Mapcar(VoidFunctionPtr func)
+{
+    PendingInterrupt *pend;
+    int i;
+
+    for (i = 0; i <= OverflowSlot; i++)
+	for (pend = head[i]; pend != NULL; pend = pend->next)
+	    (*func)((int)pend);
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +355,8 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new TimerWheel;
+    freePending = NULL;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,9 +369,13 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete pending->Remove();
+    PendingInterrupt *pend;
+
     delete pending;
+    while ((pend = freePending) != NULL) {
+	freePending = pend->next;
+	delete pend;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -178,6 +478,26 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::QuietUntil
+// 	Return the earliest simulated time at which a call to OneTick
+//	might do anything besides advance the clock.  Until then the
+//	machine simulation may run user instructions without calling
+//	OneTick, as long as it charges their ticks itself.
+//
+//	When the next interrupt is more than a level 0 turn of the timer
+//	wheel away, this is only a bound; the OneTick there moves the
+//	wheel on, and the next call gets closer.
+//----------------------------------------------------------------------
+
+int
+Interrupt::QuietUntil()
+{
+    if (yieldOnReturn)
+	return stats->totalTicks;
+    return pending->NextTime();
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -244,6 +564,12 @@ Interrupt::Halt()
     float avg_completion, var_completion=0;
     unsigned i;
 
+#ifdef FILESYS
+    // Get the file system onto the disk while we can still wait for it;
+    // Cleanup may be called from a signal handler
+    bufferCache->Flush();
+#endif
+
     printf("Machine halting!\n\n");
     stats->Print();
 
@@ -300,7 +626,8 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on the timer wheel, reusing a
+//	PendingInterrupt from the pool if there is one.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -315,13 +642,22 @@ void
 Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    PendingInterrupt *toOccur = freePending;
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    if (toOccur == NULL) {
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    } else {
+	freePending = toOccur->next;
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    }
+    pending->Insert(toOccur, stats->totalTicks);
 }
 
 //----------------------------------------------------------------------
@@ -348,25 +684,22 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (DebugIsEnabled('i'))
 	DumpState();
     PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+		pending->First(advanceClock ? INT_MAX : stats->totalTicks);
 
-    if (toOccur == NULL)		// no pending interrupts
-	return FALSE;			
+    if (toOccur == NULL)		// no pending interrupts, or
+	return FALSE;			// not time yet
+    when = toOccur->when;
 
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
     }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+				&& (pending->NumPending() == 1))
 	 return FALSE;
-    }
+    pending->Remove(toOccur);
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
@@ -381,7 +714,8 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    toOccur->next = freePending;		// back to the pool
+    freePending = toOccur;
     return TRUE;
 }
 
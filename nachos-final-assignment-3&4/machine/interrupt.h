@@ -48,9 +48,10 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
+// display and keyboard, and a network.  TimeoutInt is the one-shot
+// alarm the kernel's TimeoutQueue sets for its next timeout.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, TimeoutInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -67,6 +68,61 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+
+    PendingInterrupt *next, *prev;	// Neighbours in its TimerWheel slot;
+				// "next" also links the free pool
+    int slot;			// Which slot of the TimerWheel it is in
+};
+
+// The interrupts scheduled to occur in the future, kept in a
+// hierarchical timing wheel.  Level 0 has a slot for each of the next
+// WheelSlots ticks; each slot of level 1 covers WheelSlots ticks, each
+// slot of level 2 WheelSlots level 1 slots, and so on.  An interrupt
+// goes in the lowest level that reaches far enough ahead, and when the
+// wheel reaches the start of a slot of a higher level, the interrupts
+// in it are spread out over the levels below ("cascading").  Interrupts
+// further ahead than the whole wheel wait in an overflow slot.
+//
+// So scheduling an interrupt, and taking one off, is O(1).  A bitmap
+// of the non-empty slots of each level lets the wheel jump straight
+// to the next slot with anything in it.  Interrupts due at the same
+// time fire in the order they were scheduled, as from a sorted list.
+
+#define WheelLevels	4
+#define WheelBits	6
+#define WheelSlots	(1 << WheelBits)		// slots per level
+#define OverflowSlot	(WheelLevels * WheelSlots)	// the last slot
+
+class TimerWheel {
+  public:
+    TimerWheel();
+    ~TimerWheel();			// deletes the interrupts still on it
+
+    void Insert(PendingInterrupt *pend, int now);	// "now" is the
+					// current time; pend->when is later
+    PendingInterrupt *First(int limit);	// Move the wheel on, up to "limit"
+					// at most, and return the earliest
+					// interrupt if it is due by then
+    void Remove(PendingInterrupt *pend);
+    int NextTime();			// No interrupt is due before this;
+					// INT_MAX if there are none
+    bool IsEmpty() { return (count == 0); }
+    int NumPending() { return count; }
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every interrupt
+
+  private:
+    PendingInterrupt *head[OverflowSlot + 1];	// the slots, each a FIFO
+    PendingInterrupt *tail[OverflowSlot + 1];
+    unsigned int occupied[WheelLevels][WheelSlots / 32];  // non-empty slots
+    int current;			// the time the wheel has reached;
+					// nothing on it is due before this
+    int count;				// interrupts on the wheel
+
+    int SlotFor(int when);		// where an interrupt due at "when" goes
+    void Link(PendingInterrupt *pend, bool atHead);
+    void Unlink(PendingInterrupt *pend);
+    void Cascade(int slot);		// spread out the interrupts in "slot"
+    int NextStop();			// the next time the wheel must stop at
 };
 
 // The following class defines the data structures for the simulation
@@ -112,10 +168,15 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    int QuietUntil();			// Earliest time at which OneTick 
+					// could do more than advance the
+					// clock
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    TimerWheel *pending;	// the interrupts scheduled to occur
+				// in the future
+    PendingInterrupt *freePending;	// pool of PendingInterrupts to reuse
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
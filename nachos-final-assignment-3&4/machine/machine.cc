@@ -61,6 +61,10 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
+    decodeCache = new Instruction[MemorySize / 4];
+    decodeValid = new bool[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeValid[i] = FALSE;
 
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
@@ -73,6 +77,7 @@ Machine::Machine(bool debug)
 #endif
 
     singleStep = debug;
+    trapped = FALSE;
     CheckEndian();
 }
 
@@ -84,6 +89,8 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] decodeCache;
+    delete [] decodeValid;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -109,6 +116,8 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
     interrupt->setStatus(UserMode);
+    trapped = TRUE;			// set only now: the handler may have
+					// run other threads' blocks meanwhile
 }
 
 //----------------------------------------------------------------------
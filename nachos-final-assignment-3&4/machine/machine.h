@@ -124,11 +124,24 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void InvalidateDecodedPage(int pageFrame);
+				// forget any decoded instructions cached
+				// for "pageFrame"; must be called whenever
+				// the kernel changes the contents of a frame
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
     void OneInstruction(Instruction *instr); 	
     				// Run one instruction of a user program.
+    void RunBlock(Instruction *instr);
+				// Run user instructions up to the end of
+				// a basic block, or until an interrupt
+				// might be due.
+    bool FetchInstruction(Instruction *instr);
+				// Fetch and decode the instruction at the
+				// PC, using the decoded instruction cache.
+				// Return FALSE if the fetch trapped.
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -138,6 +151,17 @@ class Machine {
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
     
+    bool CopyIn(int addr, int size, char *into);
+    bool CopyOut(char *from, int size, int addr);
+				// Copy "size" bytes of virtual memory at
+				// addr into/out of a kernel buffer, a page
+				// at a time.  Page faults are taken here;
+				// return FALSE on a bad address.
+    int CopyInString(int addr, char *into, int maxSize);
+				// Copy a NUL-terminated string in, at most
+				// maxSize - 1 characters; return its
+				// length, or -1 on a bad address.
+    
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
@@ -197,6 +221,18 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    bool trapped;		// set when an instruction raised an
+				// exception, or took pagingLock (which
+				// lets time move on), so RunBlock can end
+				// the block
+
+    Instruction *decodeCache;	// decoded form of every word of physical
+				// memory, indexed by physical address / 4
+    bool *decodeValid;		// TRUE if the matching decodeCache entry
+				// is up to date with mainMemory
+
+    bool KernelTranslate(int addr, int *physAddr, bool writing);
+				// Translate for a copy, taking page faults
 };
 
 extern void ExceptionHandler(ExceptionType which);
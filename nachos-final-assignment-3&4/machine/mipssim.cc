@@ -37,13 +37,58 @@ Machine::Run()
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
-	interrupt->OneTick();
+	if (blockExecution && !singleStep && !DebugIsEnabled('i'))
+	    RunBlock(instr);
+	else {
+            OneInstruction(instr);
+	    interrupt->OneTick();
+	}
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute user instructions straight through to the end of the
+//	current basic block (the first instruction that does not fall
+//	through to PC + 4), with the decoded instructions coming out of
+//	the decode cache.
+//
+//	Interrupts are only looked at when one could actually be due:
+//	until Interrupt::QuietUntil, OneTick would just add UserTick to
+//	the clock, so we charge that here and skip it.  The instruction
+//	at which something may fire, and any instruction that traps into
+//	the kernel, are followed by a real OneTick, exactly as in Run, so
+//	simulated time, statistics and interrupt order are the same as
+//	when executing one instruction at a time.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlock(Instruction *instr)
+{
+    int quietUntil = interrupt->QuietUntil();
+    int startPC;
+
+    trapped = FALSE;
+    while (stats->totalTicks + UserTick < quietUntil) {
+	startPC = registers[PCReg];
+	OneInstruction(instr);
+	if (trapped) {			// the kernel ran; time moves on
+	    interrupt->OneTick();	// as after any other instruction
+	    return;
+	}
+	stats->totalTicks += UserTick;
+	stats->userTicks += UserTick;
+	if (registers[PCReg] != startPC + 4)
+	    return;			// end of the basic block
+    }
+
+    // an interrupt may be due once this instruction is done
+    OneInstruction(instr);
+    interrupt->OneTick();
+}
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -93,16 +138,13 @@ TypeToReg(RegType reg, Instruction *instr)
 void
 Machine::OneInstruction(Instruction *instr)
 {
-    int raw;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    // Fetch instruction, already decoded
+    if (!FetchInstruction(instr))
 	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
@@ -20,8 +20,12 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numDiskRequests = numDiskMerges = diskSeekTracks = 0;
+    numCacheHits = numCacheMisses = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageIns = numPageOuts = numCopyOnWrites = numTextShares = 0;
+    numZeroFills = 0;
     
     total_wait_time = 0;
     cpu_time = 0;
@@ -48,9 +52,18 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if (numDiskRequests > 0)
+	printf("Disk scheduling: requests %d, merged %d, average seek %.2f "
+	    "tracks\n", numDiskRequests, numDiskMerges,
+	    (float)diskSeekTracks/numDiskRequests);
+    if (numCacheHits + numCacheMisses > 0)
+	printf("Buffer cache: hits %d, misses %d\n", numCacheHits,
+	    numCacheMisses);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d, swap ins %d, swap outs %d, copy-on-write %d, "
+	"shared text %d, zero-fill %d\n", numPageFaults, numPageIns,
+	numPageOuts, numCopyOnWrites, numTextShares, numZeroFills);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 
@@ -45,9 +45,19 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskRequests;	// number of requests SynchDisk sent the disk
+    int numDiskMerges;		// of those, how many continued the one before
+    int diskSeekTracks;		// total tracks the head moved for them
+    int numCacheHits;		// file system sectors found in the buffer cache
+    int numCacheMisses;		// and not found there
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageIns;		// number of pages read back from swap
+    int numPageOuts;		// number of dirty pages written to swap
+    int numCopyOnWrites;	// number of frames copied on a write after fork
+    int numTextShares;		// number of text pages found already in memory
+    int numZeroFills;		// number of bss/stack pages zeroed on first use
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
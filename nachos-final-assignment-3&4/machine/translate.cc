@@ -72,9 +72,6 @@ WordToMachine(unsigned int word) { return WordToHost(word); }
 unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
-extern int* getLRUClockFrame();
-extern void printQueue();
-
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
@@ -168,10 +165,544 @@ Machine::WriteMem(int addr, int size, int value)
 	
       default: ASSERT(FALSE);
     }
+
+    // the word may have been executed before (self-modifying code)
+    decodeValid[physicalAddress / 4] = FALSE;
     
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::KernelTranslate
+//      Translate "addr" for the kernel, which is copying to or from
+//	user memory on behalf of a system call.  A page fault is taken
+//	here: with demand paging, Translate has brought the page in
+//	(sleeping while the pager did the I/O) by the time it returns
+//	PageFaultException, so the translation is just tried again.
+//	Nothing is raised to the user program.
+//
+//   	Returns FALSE if the address is bad.
+//
+//	"addr" -- the virtual address
+//	"physAddr" -- the place to store the physical address
+// 	"writing" -- if TRUE, the kernel is about to write there
+//----------------------------------------------------------------------
+
+bool
+Machine::KernelTranslate(int addr, int *physAddr, bool writing)
+{
+    ExceptionType exception;
+
+    for (;;) {
+	exception = Translate(addr, physAddr, 1, writing);
+	if (exception == NoException)
+	    return TRUE;
+	if ((exception != PageFaultException) || (pageAlgo == NORMAL))
+	    return FALSE;
+	stats->numPageFaults++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyIn
+//      Copy "size" bytes of virtual memory at "addr" into the kernel
+//	buffer "into".  Each page is translated once, and the part of
+//	it that is wanted copied as a whole.
+//
+//   	Returns FALSE if part of the range is not a good address; what
+//	was before it has been copied.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyIn(int addr, int size, char *into)
+{
+    int physicalAddress, n;
+
+    while (size > 0) {
+	n = min(size, PageSize - (int) ((unsigned) addr % PageSize));
+	if (!KernelTranslate(addr, &physicalAddress, FALSE))
+	    return FALSE;
+	bcopy(&mainMemory[physicalAddress], into, n);
+	addr += n;
+	into += n;
+	size -= n;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyOut
+//      Copy "size" bytes of the kernel buffer "from" into virtual
+//	memory at "addr", a page at a time, as CopyIn.
+//
+//   	Returns FALSE if part of the range is not a good address; what
+//	was before it has been copied.
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyOut(char *from, int size, int addr)
+{
+    int physicalAddress, n, word;
+
+    while (size > 0) {
+	n = min(size, PageSize - (int) ((unsigned) addr % PageSize));
+	if (!KernelTranslate(addr, &physicalAddress, TRUE))
+	    return FALSE;
+	bcopy(from, &mainMemory[physicalAddress], n);
+
+	// the words may have been executed before (self-modifying code)
+	for (word = physicalAddress / 4; word <= (physicalAddress + n - 1) / 4;
+		word++)
+	    decodeValid[word] = FALSE;
+	addr += n;
+	from += n;
+	size -= n;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyInString
+//      Copy the NUL-terminated string at virtual address "addr" into
+//	the kernel buffer "into", which has room for "maxSize" bytes.
+//	The string is looked for a page at a time.  If it is longer than
+//	maxSize - 1 characters, only that many are copied; "into" is
+//	always NUL-terminated.
+//
+//   	Returns the number of characters copied, or -1 if the string
+//	runs into a bad address.
+//----------------------------------------------------------------------
+
+int
+Machine::CopyInString(int addr, char *into, int maxSize)
+{
+    int physicalAddress, n, length = 0;
+    char *end;
+
+    ASSERT(maxSize > 0);
+    while (length < maxSize - 1) {
+	n = min(maxSize - 1 - length,
+		PageSize - (int) ((unsigned) addr % PageSize));
+	if (!KernelTranslate(addr, &physicalAddress, FALSE))
+	    return -1;
+	end = (char *) memchr(&mainMemory[physicalAddress], '\0', n);
+	if (end != NULL)
+	    n = end - &mainMemory[physicalAddress];
+	bcopy(&mainMemory[physicalAddress], &into[length], n);
+	length += n;
+	addr += n;
+	if (end != NULL)
+	    break;
+    }
+    into[length] = '\0';
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+//      Fetch the instruction at the current PC into "instr", already
+//	decoded.  Translation is done on every fetch, exactly as ReadMem
+//	would, so that the use bits and the page replacement bookkeeping
+//	see every reference; only the Decode step is skipped when the
+//	physical word has been decoded before.
+//
+//   	Returns FALSE if the translation step from virtual to physical memory
+//   	failed.
+//----------------------------------------------------------------------
+
+bool
+Machine::FetchInstruction(Instruction *instr)
+{
+    ExceptionType exception;
+    int physicalAddress;
+    int addr = registers[PCReg];
+    int word;
+
+    DEBUG('a', "Reading VA 0x%x, size %d\n", addr, 4);
+
+    exception = Translate(addr, &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+	machine->RaiseException(exception, addr);
+	return FALSE;
+    }
+
+    word = physicalAddress / 4;
+    if (!decodeValid[word]) {
+	decodeCache[word].value =
+		WordToHost(*(unsigned int *) &mainMemory[physicalAddress]);
+	decodeCache[word].Decode();
+	decodeValid[word] = TRUE;
+    }
+    *instr = decodeCache[word];
+
+    DEBUG('a', "\tvalue read = %8.8x\n", instr->value);
+    return (TRUE);
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+//      Drop the decoded instructions cached for physical page "pageFrame".
+//	Called by the kernel whenever it loads, copies or zeroes a frame
+//	behind the simulated CPU's back.
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodedPage(int pageFrame)
+{
+    int i, first = pageFrame * (PageSize / 4);
+
+    ASSERT((pageFrame >= 0) && (pageFrame < NumPhysPages));
+    for (i = 0; i < PageSize / 4; i++)
+	decodeValid[first + i] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// SelectVictim
+//      Choose the frame to evict, with the page replacement algorithm in
+//      force.  Frames holding shared memory are never chosen, since the
+//      address spaces sharing them would each page it back in to a frame
+//      of their own; neither is "keep" (-1 if any frame will do).
+//----------------------------------------------------------------------
+
+static int
+SelectVictim(int keep)
+{
+    int frameToReplace;
+
+    for (;;) {
+        // Select the frame according to the algorithm
+        if(pageAlgo == FIFO) {
+            frameToReplace = removeFromPageQueue();
+            DEBUG('R', "\n\tFIFO selects frame %d", frameToReplace);
+        } else if (pageAlgo == RANDOM) {
+            frameToReplace = rand()%(NumPhysPages-1);
+            DEBUG('R', "\n\tRANDOM selects frame %d", frameToReplace);
+        } else if (pageAlgo == LRU) {
+            frameToReplace = removeFromPageQueue();
+            DEBUG('R', "\n\tLRU selects frame %d", frameToReplace);
+        } else if (pageAlgo == LRU_CLOCK) {
+            frameToReplace = getClockFrame(FALSE);
+            DEBUG('R', "\n\tLRU CLOCK selects frame %d", frameToReplace);
+        } else {
+            ASSERT(pageAlgo == WS_CLOCK);
+            frameToReplace = getClockFrame(TRUE);
+            DEBUG('R', "\n\tWS CLOCK selects frame %d", frameToReplace);
+        }
+        ASSERT(frameToReplace != -1);
+
+        if (frameToReplace != keep && pageEntries[frameToReplace] != NULL
+                && !pageEntries[frameToReplace]->shared)
+            return frameToReplace;
+
+        // Passed over; a queued frame goes back at the tail
+        if (pageAlgo == FIFO || pageAlgo == LRU)
+            appendToPageQueue(frameToReplace);
+    }
+}
+
+//----------------------------------------------------------------------
+// EvictFrame
+//      Take "frame" away from every entry mapping it.  Each entry whose
+//      page is dirty is written to its swap slot by the pager; the page
+//      is copied when the write is queued, so the frame is free for
+//      reuse as soon as this returns.
+//----------------------------------------------------------------------
+
+static void
+EvictFrame(int frame)
+{
+    TranslationEntry *frameEntry;
+
+    removeTextFrame(frame);
+    while ((frameEntry = pageEntries[frame]) != NULL) {
+        DEBUG('R', "\n\tvirtual %d physical %d thread %d shared %d valid %d", 
+                frameEntry->virtualPage, frameEntry->physicalPage, 
+                frameEntry->threadPid, frameEntry->shared,
+                frameEntry->valid);
+
+        // Now this page should no longer be valid; once paged back in it
+        // will not be sharing a frame any more
+        removeFrameMapping(frame, frameEntry);
+        frameEntry->valid = FALSE;
+        frameEntry->readOnly = FALSE;
+        frameEntry->copyOnWrite = FALSE;
+        threadArray[frameEntry->threadPid]->space->validPages--;
+
+        // Now we have to write the page to its swap slot in case it
+        // is dirty; it is cached, and clean until it is modified again
+        // after being brought back
+        if(frameEntry->dirty) {
+            DEBUG('R', "\n\tpage %d of thread %d is dirty"
+                    , frameEntry->virtualPage, frameEntry->threadPid);
+
+            if(frameEntry->swapSlot == -1) {
+                frameEntry->swapSlot = swapSpace->AllocateSlot();
+            }
+            frameEntry->cached = TRUE;
+            frameEntry->dirty = FALSE;
+            pager->PageOut(frameEntry->swapSlot, frame);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// AllocateFrame
+//      Find a physical frame for a page, evicting one if memory is full.
+//      The frame returned is mapped by no entry.  "keep" is a frame that
+//      must not be evicted, or -1.  The caller holds pagingLock.
+//----------------------------------------------------------------------
+
+static int
+AllocateFrame(int keep)
+{
+    int frame;
+
+    if(numPagesAllocated == NumPhysPages) {
+        // here we have to handle page replacement
+        ASSERT(pageAlgo != NORMAL);
+        DEBUG('R', "\nInvoking page replacement algorithm: ");
+        frame = SelectVictim(keep);
+        EvictFrame(frame);
+        DEBUG('R', "\n\n");
+    } else {
+        // Increment the numPagesAllocated
+        numPagesAllocated++;
+
+        // We either take the page from the pool of freed pages of we take a
+        // page from the pool of unallocated pages
+        int *physicalPageNumber = (int *)freedPages->Remove();
+        if(physicalPageNumber == NULL) {
+            frame = nextUnallocatedPage;
+            nextUnallocatedPage++;   // Update the number of pages allocated
+        } else {
+            frame = *physicalPageNumber;
+            delete physicalPageNumber;
+        }
+    }
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// BreakCopyOnWrite
+//      Called on a write to a copy-on-write page.  If other entries still
+//      map its frame, the page gets a copy of the frame; either way it is
+//      writable afterwards.  The entry may have been evicted while we
+//      waited for pagingLock, in which case nothing is done and the
+//      access must fault the page in again.
+//----------------------------------------------------------------------
+
+static void
+BreakCopyOnWrite(TranslationEntry *entry)
+{
+    int oldFrame, newFrame;
+    TranslationEntry *last;
+
+    pagingLock->Acquire();
+    if (!entry->valid || !entry->copyOnWrite) {
+        pagingLock->Release();
+        return;
+    }
+
+    oldFrame = entry->physicalPage;
+    if (frameRefCount[oldFrame] > 1) {
+        newFrame = AllocateFrame(oldFrame);
+        bcopy(&machine->mainMemory[oldFrame * PageSize],
+                &machine->mainMemory[newFrame * PageSize], PageSize);
+        machine->InvalidateDecodedPage(newFrame);
+
+        removeFrameMapping(oldFrame, entry);
+        entry->physicalPage = newFrame;
+        addFrameMapping(newFrame, entry);
+        if(pageAlgo == FIFO) {
+            appendToPageQueue(newFrame);
+        } else if(pageAlgo == LRU_CLOCK || pageAlgo == WS_CLOCK) {
+            ClearReferenceBit(newFrame);
+        }
+        stats->numCopyOnWrites++;
+        DEBUG('A', "Copying page %d to %d on write, VPN %d thread %d\n",
+                oldFrame, newFrame, entry->virtualPage, entry->threadPid);
+    }
+    entry->readOnly = FALSE;
+    entry->copyOnWrite = FALSE;
+
+    // The others may have exited while we were finding a frame
+    if (frameRefCount[oldFrame] == 0) {
+        releaseFrame(oldFrame);
+    } else if (frameRefCount[oldFrame] == 1) {
+        last = pageEntries[oldFrame];
+        last->readOnly = FALSE;
+        last->copyOnWrite = FALSE;
+    }
+    pagingLock->Release();
+}
+
+//----------------------------------------------------------------------
+// MapLoadedPage
+//      Make "entry" of the current address space map "pageFrame", which
+//      has just been filled with its contents.
+//----------------------------------------------------------------------
+
+static void
+MapLoadedPage(TranslationEntry *entry, int pageFrame)
+{
+    AddrSpace *space = currentThread->space;
+
+    entry->physicalPage = pageFrame;
+
+    // In case of FIFO we maintain a fifo queue of elements; the
+    // clock algorithms only need the frame's reference bit cleared,
+    // the first access will set it
+    if(pageAlgo == FIFO) {
+        appendToPageQueue(pageFrame);
+        DEBUG('Q', "FIFO Update ");
+        printQueue();
+    } else if(pageAlgo == LRU_CLOCK || pageAlgo == WS_CLOCK) {
+        ClearReferenceBit(pageFrame);
+    }
+
+    // Whatever was decoded from the old contents is stale now
+    machine->InvalidateDecodedPage(pageFrame);
+
+    // The number of valid pages of this thread has increased
+    space->validPages++;
+
+    // Mark this pagetable entry as valid, and record that it maps
+    // the frame
+    entry->valid = TRUE;
+    addFrameMapping(pageFrame, entry);
+
+    // Text is never written; let other processes running this
+    // executable find the frame, unless one beat us to it
+    if(space->GetPageBacking(entry->virtualPage) == TextPage) {
+        entry->readOnly = TRUE;
+        if(findTextFrame(space->execId, entry->virtualPage) == -1) {
+            addTextFrame(pageFrame, space->execId, entry->virtualPage);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// LoadFromExecutable
+//      Read page "vpn" of the current address space from its executable,
+//      together with the pages after it when the process seems to be
+//      faulting its way through memory in order.  The cluster doubles
+//      on every fault at the page where the last one ended, up to
+//      MAX_PAGE_CLUSTER pages, and drops back to one page on any other
+//      fault.  All of it is read with a single ReadAt.
+//
+//      The extra pages are only brought into free frames: it is not
+//      worth evicting a page for one that may never be used.  A page
+//      that is already resident, has been written to swap, is a text
+//      page in memory elsewhere or has nothing in the file ends the
+//      cluster.
+//
+//      The caller holds pagingLock.  It is let go while the pager reads,
+//      so that other threads can fault meanwhile; the frames are mapped
+//      by nothing until the data is in, so nobody can take them.
+//----------------------------------------------------------------------
+
+static void
+LoadFromExecutable(unsigned vpn)
+{
+    AddrSpace *space = currentThread->space;
+    TranslationEntry *pageTable = space->GetPageTable();
+    int frames[MAX_PAGE_CLUSTER];
+    unsigned count, i;
+
+    if (vpn == space->nextClusterVpn)
+        space->clusterSize = min(2 * space->clusterSize, MAX_PAGE_CLUSTER);
+    else
+        space->clusterSize = 1;
+
+    frames[0] = AllocateFrame(-1);
+    for (count = 1; count < (unsigned)space->clusterSize; count++) {
+        i = vpn + count;
+        if (i >= space->GetNumPages() || pageTable[i].valid || pageTable[i].cached
+                || pageTable[i].shared || numPagesAllocated == NumPhysPages)
+            break;
+        if (space->GetPageBacking(i) == ZeroFillPage)
+            break;
+        if (space->GetPageBacking(i) == TextPage
+                && findTextFrame(space->execId, i) != -1)
+            break;
+        frames[count] = AllocateFrame(-1);
+    }
+    space->nextClusterVpn = vpn + count;
+
+    DEBUG('A', "Reading %d pages from VPN %d of %s, first into frame %d\n",
+            count, vpn, space->filename, frames[0]);
+
+    pagingLock->Release();
+    pager->ReadPages(space->executableFile,
+            space->noffH.code.inFileAddr + vpn * PageSize, frames, count);
+    pagingLock->Acquire();
+
+    for (i = 0; i < count; i++)
+        MapLoadedPage(&pageTable[vpn + i], frames[i]);
+}
+
+//----------------------------------------------------------------------
+// MapTextPage
+//      Called on a fault on a page of the current address space.  If it
+//      is a text page that some process running the same executable has
+//      in memory, map the same frame read-only and return TRUE: no I/O
+//      is needed.  Otherwise return FALSE.
+//----------------------------------------------------------------------
+
+static bool
+MapTextPage(TranslationEntry *entry)
+{
+    AddrSpace *space = currentThread->space;
+    int frame;
+
+    if (space->GetPageBacking(entry->virtualPage) != TextPage)
+        return FALSE;
+
+    pagingLock->Acquire();
+    frame = findTextFrame(space->execId, entry->virtualPage);
+    if (frame != -1) {
+        DEBUG('A', "Sharing text page %d of %s in frame %d\n",
+                entry->virtualPage, space->filename, frame);
+        entry->physicalPage = frame;
+        entry->readOnly = TRUE;
+        entry->valid = TRUE;
+        addFrameMapping(frame, entry);
+        space->validPages++;
+        stats->numTextShares++;
+    }
+    pagingLock->Release();
+    return (frame != -1);
+}
+
+//----------------------------------------------------------------------
+// MapZeroPage
+//      Called on a fault on a page of the current address space.  If the
+//      page is bss or stack that has never been written out to swap, it
+//      is zero: give it a zeroed frame and return TRUE.  As there is no
+//      I/O the access goes ahead without a page fault.  Otherwise return
+//      FALSE.
+//----------------------------------------------------------------------
+
+static bool
+MapZeroPage(TranslationEntry *entry)
+{
+    int pageFrame;
+
+    if (entry->cached ||
+            currentThread->space->GetPageBacking(entry->virtualPage) != ZeroFillPage)
+        return FALSE;
+
+    pagingLock->Acquire();
+    pageFrame = AllocateFrame(-1);
+    DEBUG('A', "Zero filling physical page %d VPN %d\n", pageFrame,
+            entry->virtualPage);
+    bzero(&machine->mainMemory[pageFrame * PageSize], PageSize);
+    MapLoadedPage(entry, pageFrame);
+    stats->numZeroFills++;
+    pagingLock->Release();
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -190,13 +721,12 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i, j;
+    int i;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
     int flag = 0;
     unsigned int numPages = currentThread->space->GetNumPages();
-    unsigned int StartMachine, StartBackup;
 
     DEBUG('a', "\tTranslate 0x%x, %s: \n\t", virtAddr, writing ? "write" : "read");
 
@@ -233,160 +763,40 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
         }
         entry = &pageTable[vpn];
 
-        // Demand Paging
+        // A text page already in memory is just mapped, and a bss or stack
+        // page just zeroed; the access can go ahead without a page fault.
+        // Either may take pagingLock, which lets time move on, so the
+        // instruction counts as a trap for RunBlock
         if(flag) {
-            unsigned int size = numPages * PageSize;
-            unsigned int readSize = PageSize;
-
-            if(numPagesAllocated == NumPhysPages) {
-                // here we have to handle page replacement
-                DEBUG('R', "\nInvoking page replacement algorithm: ");
-
-                // The frame which will be replace
-                int *frameToReplace;
-                TranslationEntry *frameEntry;
-
-                // Select the frame according to the algorithm
-                if(pageAlgo == FIFO) {
-                    frameToReplace = (int *)pageQueue->Remove();
-                    DEBUG('R', "\n\tFIFO selects frame %d", *frameToReplace);
-                } else if (pageAlgo == RANDOM) {
-                    frameToReplace = new int(rand()%(NumPhysPages-1));
-                    DEBUG('R', "\n\tRANDOM selects frame %d", *frameToReplace);
-                } else if (pageAlgo == LRU) {
-                    frameToReplace = (int *)pageQueue->Remove();
-                    DEBUG('R', "\n\tLRU selects frame %d", *frameToReplace);
-                } else if (pageAlgo == LRU_CLOCK) {
-                    frameToReplace = getLRUClockFrame();
-                    DEBUG('R', "\n\tLRU CLOCK selects frame %d", *frameToReplace);
-                }
-
-                // Get the PTE of this frame
-                frameEntry = pageEntries[*frameToReplace];
-                Thread *thread = threadArray[frameEntry->threadPid];
-
-                // We have to delete the frameToReplace
-                delete frameToReplace;
-
-                DEBUG('R', "\n\tvirtual %d physical %d thread %d shared %d valid %d", 
-                        frameEntry->virtualPage, frameEntry->physicalPage, 
-                        frameEntry->threadPid, frameEntry->shared,
-                        frameEntry->valid);
-
-                // Now this page should no longer be valid
-                frameEntry->valid = FALSE;
-                thread->space->validPages--;
-
-                // Now we have to copy the values between the backupMemory and
-                // machineMemory in case the page is dirty
-                if(frameEntry->dirty) {
-                    DEBUG('R', "\n\tpage %d of thread %d is dirty"
-                            , frameEntry->virtualPage, frameEntry->threadPid);
-
-                    // Now this frameEntry is cached
-                    frameEntry->cached = TRUE;
-
-                    // Now we have to copy the mainMemory to backupMemory
-                    StartMachine = frameEntry->physicalPage * PageSize;
-                    StartBackup = frameEntry->virtualPage * PageSize;
-                    for(j=0; j<PageSize; j++) {
-                        thread->backupMemory[StartBackup+j] = machine->mainMemory[StartMachine+j];
-                        DEBUG('r', "B: %d\n", thread->backupMemory[StartBackup+j]);
-                        DEBUG('r', "M: %d\n", machine->mainMemory[StartMachine+j]);
-                    }
-                }
-
-                // Now we have to change the pageframe of entry
-                entry->physicalPage = frameEntry->physicalPage;
-                DEBUG('R', "\n\n");
-            } else {
-                // Increment the numPagesAllocated
-                numPagesAllocated++;
-
-                // We either take the page from the pool of freed pages of we take a
-                // page from the pool of unallocated pages
-                int *physicalPageNumber = (int *)freedPages->Remove();
-                if(physicalPageNumber == NULL) {
-                    entry->physicalPage = nextUnallocatedPage;
-                    nextUnallocatedPage++;   // Update the number of pages allocated
-                } else {
-                    entry->physicalPage = *physicalPageNumber;
-                    delete physicalPageNumber;
-                }
-            }
-
-            // This stores a refernce to the pageTable entry
-            pageEntries[entry->physicalPage] = entry;
-
-            // This is for ease of access
-            pageFrame = entry->physicalPage;
-
-            DEBUG('A', "Allocating physical page %d VPN %d virtualaddress %d\n", pageFrame, vpn, virtAddr);
-
-            // In case of FIFO or LRU_CLOCK we maintain a fifo queue of elements
-            if(pageAlgo == FIFO) {
-                int *temp = new int(pageFrame);
-                pageQueue->Append((void *)temp);
-                DEBUG('Q', "FIFO Update ");
-                printQueue();
-            }
-
-            if(pageAlgo == LRU_CLOCK){
-                deleteFromPageQueue(pageFrame);
-                int *temp = new int(pageFrame);
-                pageQueue->Append((void *)temp);
-
-                // If this is the first page fault then we set the LRU_CLOCK
-                // hand
-                if(stats->numPageFaults == 0) {
-                    DEBUG('q', "Setting the LRU_CLOCK Hand to %d\n", *temp);
-                    LRUClockhand = new int(*temp);
-                }
-
-                DEBUG('Q', "LRU_CLK List \t ");
-                printQueue();
+            trapped = TRUE;
+            if(MapTextPage(entry) || MapZeroPage(entry)) {
+                flag = 0;
             }
+        }
 
-            // zero out this particular page
-            bzero(&machine->mainMemory[pageFrame*PageSize], PageSize);
+        // Demand Paging
+        if(flag) {
+            // The lock covers choosing frames and mapping them; the I/O
+            // is done by the pager, and we sleep until it is finished
+            pagingLock->Acquire();
 
-            // Now here are two cases, we may either have to use the
-            // backupMemory of the thread or the mainMemory
+            // Now here are two cases, we may either have to read the page
+            // back from its swap slot or from the executable
             if(entry->cached) {
                 DEBUG('R', "page %d of %d has been modified\n", 
                         entry->virtualPage, entry->threadPid);
 
-                StartMachine = pageFrame * PageSize;
-                StartBackup = entry->virtualPage * PageSize;
-                for(j=0; j<PageSize; ++j) {
-                    machine->mainMemory[StartMachine+j] = currentThread->backupMemory[StartBackup+j];
-                }
+                pageFrame = AllocateFrame(-1);
+                DEBUG('A', "Allocating physical page %d VPN %d virtualaddress %d\n", pageFrame, vpn, virtAddr);
+                pagingLock->Release();
+                pager->PageIn(entry->swapSlot, pageFrame);
+                pagingLock->Acquire();
+                MapLoadedPage(entry, pageFrame);
             } else {
-                // Now copy the corresponding area from memory
-                if( vpn == (numPages - 1) ) {
-                    readSize = size - vpn * PageSize;
-                }
-
-                executable->ReadAt(&(machine->mainMemory[pageFrame * PageSize]),
-                        readSize, noffH.code.inFileAddr + vpn*PageSize);
-            }
-                executable->ReadAt(&(machine->mainMemory[pageFrame * PageSize]),
-                        readSize, noffH.code.inFileAddr + vpn*PageSize);
-
-                // delete the opened executable
-                delete executable;
+                LoadFromExecutable(vpn);
             }
 
-            // The number of valid pages of this thread has increased
-            currentThread->space->validPages++;
-
-            // Mark this pagetable entry as valid
-            entry->valid = TRUE;
-
-            // Now store this entry into the hashMap of pageEntries
-            DEBUG('R', "Adding pageEntry for %d\n", entry->physicalPage);
-            pageEntries[entry->physicalPage] = entry;
-
+            pagingLock->Release();
             return PageFaultException;
         }
     } else {
@@ -404,8 +814,18 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
-        DEBUG('a', "%d mapped read-only at %d in TLB!\n", virtAddr, i);
-        return ReadOnlyException;
+        if (!entry->copyOnWrite) {
+            DEBUG('a', "%d mapped read-only at %d in TLB!\n", virtAddr, i);
+            return ReadOnlyException;
+        }
+
+        // The frame is shared with a forked address space; give this
+        // entry a frame of its own and carry on with the write.  This
+        // takes pagingLock, so it counts as a trap for RunBlock too
+        trapped = TRUE;
+        BreakCopyOnWrite(entry);
+        if (!entry->valid)		// evicted while we waited
+            return Translate(virtAddr, physAddr, size, writing);
     }
     pageFrame = entry->physicalPage;
 
@@ -424,21 +844,16 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // A new frame is updated so ww change the LRU pageQueue
     if(pageAlgo == LRU) {
-        // First of all we delete the element if it's in the queue
+        // Move the frame to the tail of the queue; victims are taken from
+        // the head, so this is the same as LRU.  Both steps are O(1).
         deleteFromPageQueue(pageFrame);
-
-        // We add this element to the bottom of the pageQueue, every time we
-        // pop, we pop from the head so this is the same as LRU
-        int *temp = new int(pageFrame);
-        pageQueue->Append((void *)temp);
+        appendToPageQueue(pageFrame);
         DEBUG('Q', "LRU Update %d\t", pageFrame);
         printQueue();
-    } else if (pageAlgo == LRU_CLOCK) {
+    } else if (pageAlgo == LRU_CLOCK || pageAlgo == WS_CLOCK) {
         // We have to set the reference bit of the element if it's not set and
         // let it remain the same if it's set
-        referenceBit[pageFrame] = 1;
-        DEBUG('Q', "LRU_C Update %d\t", pageFrame);
-        printQueue();
+        SetReferenceBit(pageFrame);
     }
 
     return NoException;
@@ -42,9 +42,16 @@ class TranslationEntry {
 			// page is modified.
     bool shared; // To indicate whether a particular page is shared or not
 
-    bool cached; // To copy from the cache rather than the executable
+    bool copyOnWrite; // readOnly only until written: the frame is shared
+		      // with a forked address space and is copied first
+
+    bool cached; // To read the page from swap rather than the executable
+
+    int swapSlot; // The swap slot holding this page, -1 if none
 
     int threadPid; // The thread to which this pageTable belongs to
+
+    TranslationEntry *nextMapping; // The next entry mapping the same frame
 };
 
 #endif
@@ -26,10 +26,10 @@ main()
 
 	buffer[--i] = '\0';
 
-	/*if( i > 0 ) {
-		newProc = Exec(buffer);
-		Join(newProc);
-	}*/
+	if( i > 0 ) {
+		newProc = Spawn(buffer, -1);
+		if( newProc != -1 ) Join(newProc);
+	}
     }
 }
 
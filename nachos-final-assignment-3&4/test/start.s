@@ -266,6 +266,14 @@ ShmAllocate:
 	j       $31
 	.end ShmAllocate
 
+	.globl Spawn
+	.ent    Spawn
+Spawn:
+	addiu $2,$0,SC_Spawn
+	syscall
+	j       $31
+	.end Spawn
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -58,7 +58,8 @@ class List {
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
 
-    void *GetMinPriorityThread (void);
+    ListElement *Front() { return first; }	// Peek at the head element,
+						// NULL if the list is empty
 
   private:
     ListElement *first;  	// Head of the list, NULL if list is empty
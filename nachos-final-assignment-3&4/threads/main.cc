@@ -8,8 +8,8 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -S <disk algorithm>
+//		-s -b -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -18,10 +18,12 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -S sets the disk scheduling algorithm (cf. system.h)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -b executes user programs a basic block at a time (must precede -x/-F)
 //    -x runs a user program
 //    -c tests the console
 //
@@ -113,7 +115,7 @@ main(int argc, char **argv)
            pageAlgo = atoi(*(argv + 1));
             DEBUG('R', "The page replacement algorithm is %d\n", pageAlgo);
            argCount = 2;
-           ASSERT((pageAlgo> 0) && (pageAlgo<= 4));
+           ASSERT((pageAlgo> 0) && (pageAlgo<= WS_CLOCK));
         } else if (!strcmp(*argv, "-P")) {
             schedPriority = atoi(*(argv + 1));
             argCount = 2;
@@ -121,11 +123,9 @@ main(int argc, char **argv)
             currentThread->SetBasePriority(schedPriority+DEFAULT_BASE_PRIORITY);
             currentThread->SetPriority(schedPriority+DEFAULT_BASE_PRIORITY);
             currentThread->SetUsage(0);
-        } else if (!strcmp(*argv, "-R")) {
-            //Read the page replacement algorithm
-           pageReplacementAlgo= atoi(*(argv + 1));
-           argCount = 2;
-           ASSERT((pageReplacementAlgo> 0) && (pageReplacementAlgo<= 4));
+        } else if (!strcmp(*argv, "-b")) {
+            // Execute user code a basic block at a time
+            blockExecution = TRUE;
         } else if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
@@ -0,0 +1,304 @@
+// readyqueue.cc
+//	Routines to keep the threads that are ready to run, in the order
+//	the scheduling algorithm wants to run them.
+//
+//	These routines assume that interrupts are already disabled.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "readyqueue.h"
+
+//----------------------------------------------------------------------
+// RunsBefore
+//	Should "a" run before "b"?  The least priority value wins, and
+//	between equals the one that has been ready longer.
+//----------------------------------------------------------------------
+
+static bool
+RunsBefore(Thread *a, Thread *b)
+{
+    if (a->GetPriority() != b->GetPriority())
+	return (a->GetPriority() < b->GetPriority());
+    return (a->readyArrival < b->readyArrival);
+}
+
+//----------------------------------------------------------------------
+// FIFOReadyQueue::FIFOReadyQueue
+//	Initialize an empty FIFO of threads.
+//----------------------------------------------------------------------
+
+FIFOReadyQueue::FIFOReadyQueue()
+{
+    list = new List;
+}
+
+FIFOReadyQueue::~FIFOReadyQueue()
+{
+    delete list;
+}
+
+void
+FIFOReadyQueue::Insert(Thread *thread)
+{
+    list->Append((void *)thread);
+}
+
+Thread *
+FIFOReadyQueue::Remove()
+{
+    return (Thread *)list->Remove();
+}
+
+bool
+FIFOReadyQueue::IsEmpty()
+{
+    return list->IsEmpty();
+}
+
+void
+FIFOReadyQueue::Mapcar(VoidFunctionPtr func)
+{
+    list->Mapcar(func);
+}
+
+//----------------------------------------------------------------------
+// PriorityReadyQueue::PriorityReadyQueue
+//	Initialize an empty heap of threads.  It grows as needed.
+//----------------------------------------------------------------------
+
+PriorityReadyQueue::PriorityReadyQueue()
+{
+    capacity = 16;
+    heap = new Thread *[capacity];
+    size = 0;
+}
+
+//----------------------------------------------------------------------
+// PriorityReadyQueue::~PriorityReadyQueue
+//	De-allocate the heap.  The threads on it are not deleted.
+//----------------------------------------------------------------------
+
+PriorityReadyQueue::~PriorityReadyQueue()
+{
+    delete [] heap;
+}
+
+void
+PriorityReadyQueue::Place(Thread *thread, int index)
+{
+    heap[index] = thread;
+    thread->readyIndex = index;
+}
+
+//----------------------------------------------------------------------
+// PriorityReadyQueue::SiftUp, PriorityReadyQueue::SiftDown
+//	Move the thread at "index" towards the root, or the leaves,
+//	until the heap order holds again.
+//----------------------------------------------------------------------
+
+void
+PriorityReadyQueue::SiftUp(int index)
+{
+    Thread *thread = heap[index];
+
+    while (index > 0 && RunsBefore(thread, heap[(index - 1) / 2])) {
+	Place(heap[(index - 1) / 2], index);
+	index = (index - 1) / 2;
+    }
+    Place(thread, index);
+}
+
+void
+PriorityReadyQueue::SiftDown(int index)
+{
+    Thread *thread = heap[index];
+    int child;
+
+    for (;;) {
+	child = 2 * index + 1;
+	if (child >= size)
+	    break;
+	if (child + 1 < size && RunsBefore(heap[child + 1], heap[child]))
+	    child++;
+	if (!RunsBefore(heap[child], thread))
+	    break;
+	Place(heap[child], index);
+	index = child;
+    }
+    Place(thread, index);
+}
+
+//----------------------------------------------------------------------
+// PriorityReadyQueue::Insert
+//	Put "thread" on the heap, in O(log n).
+//----------------------------------------------------------------------
+
+void
+PriorityReadyQueue::Insert(Thread *thread)
+{
+    Thread **bigger;
+    int i;
+
+    ASSERT(thread->readyIndex == -1);
+    if (size == capacity) {
+	bigger = new Thread *[2 * capacity];
+	for (i = 0; i < size; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	capacity *= 2;
+    }
+    Place(thread, size++);
+    SiftUp(size - 1);
+}
+
+//----------------------------------------------------------------------
+// PriorityReadyQueue::Remove
+//	Take the thread with the least priority value off the heap, in
+//	O(log n).  Returns NULL if the heap is empty.
+//----------------------------------------------------------------------
+
+Thread *
+PriorityReadyQueue::Remove()
+{
+    Thread *thread;
+
+    if (size == 0)
+	return NULL;
+
+    thread = heap[0];
+    thread->readyIndex = -1;
+    size--;
+    if (size > 0) {
+	Place(heap[size], 0);
+	SiftDown(0);
+    }
+    return thread;
+}
+
+Thread *
+PriorityReadyQueue::Front()
+{
+    if (size == 0)
+	return NULL;
+    return heap[0];
+}
+
+bool
+PriorityReadyQueue::IsEmpty()
+{
+    return (size == 0);
+}
+
+void
+PriorityReadyQueue::Mapcar(VoidFunctionPtr func)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+	(*func)((int)heap[i]);
+}
+
+//----------------------------------------------------------------------
+// UnixReadyQueue::UnixReadyQueue
+//	Initialize an empty queue.
+//----------------------------------------------------------------------
+
+UnixReadyQueue::UnixReadyQueue()
+{
+    settled = new PriorityReadyQueue;
+    numDecaying = 0;
+}
+
+UnixReadyQueue::~UnixReadyQueue()
+{
+    delete settled;
+}
+
+//----------------------------------------------------------------------
+// UnixReadyQueue::Insert
+//	Catch "thread" up with the epochs it missed, and put it with the
+//	settled threads or the decaying ones.
+//----------------------------------------------------------------------
+
+void
+UnixReadyQueue::Insert(Thread *thread)
+{
+    thread->DecayUsage();
+    if (thread->GetUsage() == 0) {
+	settled->Insert(thread);
+    } else {
+	ASSERT(numDecaying < MaxDecayingThreads);
+	decaying[numDecaying++] = thread;
+    }
+}
+
+//----------------------------------------------------------------------
+// UnixReadyQueue::Settle
+//	Bring the priorities of the decaying threads current, moving
+//	those with no usage left onto the heap.
+//----------------------------------------------------------------------
+
+void
+UnixReadyQueue::Settle()
+{
+    Thread *thread;
+    int i = 0;
+
+    while (i < numDecaying) {
+	thread = decaying[i];
+	thread->DecayUsage();
+	if (thread->GetUsage() == 0) {
+	    decaying[i] = decaying[--numDecaying];
+	    settled->Insert(thread);
+	} else {
+	    i++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// UnixReadyQueue::Remove
+//	Take the thread with the least current priority value off the
+//	queue: the top of the heap, unless a decaying thread beats it.
+//	Returns NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+Thread *
+UnixReadyQueue::Remove()
+{
+    Thread *best;
+    int i, which = -1;
+
+    Settle();
+    best = settled->Front();
+    for (i = 0; i < numDecaying; i++) {
+	if ((best == NULL) || RunsBefore(decaying[i], best)) {
+	    best = decaying[i];
+	    which = i;
+	}
+    }
+    if (which == -1)
+	return settled->Remove();
+    decaying[which] = decaying[--numDecaying];
+    return best;
+}
+
+bool
+UnixReadyQueue::IsEmpty()
+{
+    return (numDecaying == 0) && settled->IsEmpty();
+}
+
+void
+UnixReadyQueue::Mapcar(VoidFunctionPtr func)
+{
+    int i;
+
+    settled->Mapcar(func);
+    for (i = 0; i < numDecaying; i++)
+	(*func)((int)decaying[i]);
+}
@@ -0,0 +1,115 @@
+// readyqueue.h
+//	Data structures for the queue of threads that are ready to run.
+//
+//	The scheduler only needs to put threads on the queue and take
+//	the next one to run off it; how the queue is kept depends on the
+//	scheduling algorithm.  Round robin and the base scheduler run
+//	threads in arrival order, so a FIFO list is all they need.  SJF
+//	runs the thread with the least priority value, so it keeps the
+//	threads in a binary heap.  The UNIX scheduler does too, but its
+//	priorities decay while threads wait, so it needs a little more.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef READYQUEUE_H
+#define READYQUEUE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "thread.h"
+
+// The interface the scheduler uses.
+
+class ReadyQueue {
+  public:
+    virtual ~ReadyQueue() {}
+
+    virtual void Insert(Thread *thread) = 0;	// Put thread on the queue
+    virtual Thread *Remove() = 0;		// Take the next thread to run
+						// off the queue, NULL if empty
+    virtual bool IsEmpty() = 0;
+    virtual void Mapcar(VoidFunctionPtr func) = 0;	// Apply "func" to
+						// every thread on the queue
+};
+
+// Threads in the order they became ready.
+
+class FIFOReadyQueue : public ReadyQueue {
+  public:
+    FIFOReadyQueue();
+    ~FIFOReadyQueue();
+
+    void Insert(Thread *thread);
+    Thread *Remove();
+    bool IsEmpty();
+    void Mapcar(VoidFunctionPtr func);
+
+  private:
+    List *list;
+};
+
+// Threads in a binary min-heap on GetPriority(); threads of equal
+// priority leave in the order they became ready (readyArrival, set by
+// the scheduler), as they would from a linear scan of a FIFO list.
+// Each thread remembers its index in the heap (-1 when off it).
+
+class PriorityReadyQueue : public ReadyQueue {
+  public:
+    PriorityReadyQueue();
+    ~PriorityReadyQueue();
+
+    void Insert(Thread *thread);
+    Thread *Remove();
+    Thread *Front();			// the thread Remove would return,
+					// left on the heap
+    bool IsEmpty();
+    void Mapcar(VoidFunctionPtr func);
+
+  private:
+    Thread **heap;		// heap[0] runs next
+    int size;			// number of threads on the heap
+    int capacity;		// entries allocated in "heap"
+
+    void Place(Thread *thread, int index);
+    void SiftUp(int index);
+    void SiftDown(int index);
+};
+
+// A thread's UNIX usage halves every epoch (see Thread::DecayUsage),
+// and usage is an int, so 31 epochs after a thread last ran it has
+// none left.  Only one thread is charged per epoch, so no more than
+// this many threads can have usage left at once.
+
+#define MaxDecayingThreads	32
+
+// The UNIX scheduler's threads.  While they wait their usage decays,
+// and their priorities with it, but by amounts that depend on the
+// usage and not the same for all, so no order kept among them stays
+// right.  Once a thread's usage is gone, though, its priority is its
+// base priority until it runs again; those threads are kept on a heap.
+// The few others are caught up and compared with the top of the heap
+// when the next thread is chosen.  So a choice costs O(log n), however
+// many epochs have gone by.
+
+class UnixReadyQueue : public ReadyQueue {
+  public:
+    UnixReadyQueue();
+    ~UnixReadyQueue();
+
+    void Insert(Thread *thread);
+    Thread *Remove();
+    bool IsEmpty();
+    void Mapcar(VoidFunctionPtr func);
+
+  private:
+    PriorityReadyQueue *settled;	// threads with no usage left
+    Thread *decaying[MaxDecayingThreads];	// the others, in no order
+    int numDecaying;
+
+    void Settle();			// catch up the decaying threads, and
+					// move those whose usage ran out
+};
+
+#endif // READYQUEUE_H
@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	The ready list is a FIFO for the base and round robin schedulers,
+//	and a heap on thread priority for SJF and (mostly) the UNIX
+//	scheduler; see readyqueue.h.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -29,7 +30,9 @@
 
 Scheduler::Scheduler()
 { 
-    readyList = new List;
+    readyList = new FIFOReadyQueue;
+    listKind = FIFOList;
+    readyArrivals = 0;
     empty_ready_queue_start_time = -1;
 } 
 
@@ -43,6 +46,40 @@ Scheduler::~Scheduler()
     delete readyList; 
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::ReadyListFor
+// 	Return the ready list, first moving the ready threads to a new
+//	one if scheduling algorithm "algo" needs another kind of queue.
+//	The algorithm is only known once the command line, or the batch
+//	file, has been read.  The threads keep their readyArrival, so
+//	ties still go to the one that has been ready longest.
+//----------------------------------------------------------------------
+
+ReadyQueue *
+Scheduler::ReadyListFor (int algo)
+{
+    ReadyListKind want;
+    ReadyQueue *newList;
+    Thread *thread;
+
+    if (algo == NON_PREEMPTIVE_SJF) want = HeapList;
+    else if (algo == UNIX_SCHED) want = UnixList;
+    else want = FIFOList;
+
+    if (want != listKind) {
+       if (want == HeapList) newList = new PriorityReadyQueue;
+       else if (want == UnixList) newList = new UnixReadyQueue;
+       else newList = new FIFOReadyQueue;
+       while ((thread = readyList->Remove()) != NULL) {
+          newList->Insert(thread);
+       }
+       delete readyList;
+       readyList = newList;
+       listKind = want;
+    }
+    return readyList;
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
@@ -82,7 +119,8 @@ Scheduler::ReadyToRun (Thread *thread)
        stats->empty_ready_queue_time += (stats->totalTicks - empty_ready_queue_start_time);
        empty_ready_queue_start_time = -1;
     }
-    readyList->Append((void *)thread);
+    thread->readyArrival = readyArrivals++;
+    ReadyListFor(schedulingAlgo)->Insert(thread);
 }
 
 //----------------------------------------------------------------------
@@ -96,12 +134,7 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    if ((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == NON_PREEMPTIVE_SJF)){
-       return (Thread *)readyList->GetMinPriorityThread();
-    }
-    else {
-       return (Thread *)readyList->Remove();
-    }
+    return ReadyListFor(schedulingAlgo)->Remove();
 }
 
 //----------------------------------------------------------------------
@@ -218,34 +251,28 @@ Scheduler::SetEmptyReadyQueueStartTime (int ticks)
 
 //-------------------------------------------------------------------------
 // Scheduler::UpdateThreadPriority
-//      Updates the priority of all active threads as in the UNIX scheduler
+//      Charges the CPU burst that just ended to the current thread, as
+//      in the UNIX scheduler, and starts a new epoch.  The usage of all
+//      the other threads halves with every epoch too, but that is left
+//      to Thread::DecayUsage, which catches a thread up on the epochs
+//      it missed when it is next looked at; so this costs the same
+//      however many threads there are.
 //--------------------------------------------------------------------------
 void
 Scheduler::UpdateThreadPriority (void)
 {
-   unsigned i;
    int this_cpu_burst_duration = stats->totalTicks - cpu_burst_start_time;
    ASSERT(this_cpu_burst_duration > 0);
-   unsigned currentPID = currentThread->GetPID();
 
-   // First we update the currentThread priority
+   // Bring the currentThread up to date, then charge its burst to the
+   // new epoch (SetUsage records the epoch)
+
+   currentThread->DecayUsage();
+   priorityEpoch++;
 
    int currentThreadUsage = currentThread->GetUsage();
    currentThreadUsage = (currentThreadUsage + this_cpu_burst_duration) >> 1;
    int currentThreadPriority = currentThread->GetBasePriority() + (currentThreadUsage >> 1);
    currentThread->SetUsage(currentThreadUsage);
    currentThread->SetPriority(currentThreadPriority);
-
-   // Update everybody else
-
-   for (i=0; i<thread_index; i++) {
-      if ((i != currentPID) && !exitThreadArray[i]) {
-         ASSERT(threadArray[i] != NULL);
-         currentThreadUsage = threadArray[i]->GetUsage();
-         currentThreadUsage = currentThreadUsage >> 1;
-         currentThreadPriority = threadArray[i]->GetBasePriority() + (currentThreadUsage >> 1);
-         threadArray[i]->SetUsage(currentThreadUsage);
-         threadArray[i]->SetPriority(currentThreadPriority);
-      }
-   }
 }
@@ -12,6 +12,7 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "readyqueue.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -35,8 +36,14 @@ class Scheduler {
     void UpdateThreadPriority (void);	// Used by the UNIX scheduler
    
   private:
-    List *readyList;  		// queue of threads that are ready to run,
+    ReadyQueue *readyList;	// queue of threads that are ready to run,
 				// but not running
+    enum ReadyListKind { FIFOList, HeapList, UnixList };
+    ReadyListKind listKind;	// which kind of queue readyList is
+    ReadyQueue *ReadyListFor(int algo);	// readyList, rebuilt if "algo"
+				// wants another kind of queue
+    unsigned readyArrivals;	// counts ReadyToRun calls, for the
+				// tie break between equal priorities
 
     int empty_ready_queue_start_time;
 };
@@ -115,22 +115,134 @@ Semaphore::setValue(int val) {
     value = val;
 }
 
-// Dummy functions -- so we can compile our later assignments 
-// Note -- without a correct implementation of Condition::Wait(), 
-// the test case in the network assignment won't work!
-Lock::Lock(char* debugName) {}
-Lock::~Lock() {}
-void Lock::Acquire() {}
-void Lock::Release() {}
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	Initialize a lock, so that it can be used for mutual exclusion.
+//	The lock starts out FREE.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Lock::Lock(char* debugName)
+{
+    name = debugName;
+    owner = NULL;
+    queue = new List;
+}
+
+//----------------------------------------------------------------------
+// Lock::~Lock
+// 	De-allocate a lock.  Assume no one holds it or waits for it!
+//----------------------------------------------------------------------
+
+Lock::~Lock()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Lock::Acquire
+// 	Wait until the lock is FREE, then take it.  As with Semaphore::P,
+//	checking and setting the owner must be atomic.
+//----------------------------------------------------------------------
+
+void
+Lock::Acquire()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(!isHeldByCurrentThread());		// locks are not recursive
+    while (owner != NULL) {			// lock is BUSY
+	queue->Append((void *)currentThread);	// so go to sleep
+	currentThread->Sleep();
+    }
+    owner = currentThread;
+
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Release
+// 	Set the lock FREE, waking up a thread waiting in Acquire if
+//	there is one.  Only the holder may release the lock.
+//----------------------------------------------------------------------
+
+void
+Lock::Release()
+{
+    Thread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(isHeldByCurrentThread());
+    owner = NULL;
+    thread = (Thread *)queue->Remove();
+    if (thread != NULL)
+	scheduler->ReadyToRun(thread);
+
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::isHeldByCurrentThread
+// 	Return TRUE if the current thread holds this lock.
+//----------------------------------------------------------------------
+
+bool
+Lock::isHeldByCurrentThread()
+{
+    return (owner == currentThread);
+}
 
 Condition::Condition(char* debugName) {
     queue = new List();
 }
 
 Condition::~Condition() { }
-void Condition::Wait(Lock* conditionLock) { ASSERT(FALSE); }
-void Condition::Signal(Lock* conditionLock) { }
-void Condition::Broadcast(Lock* conditionLock) { }
+
+//----------------------------------------------------------------------
+// Condition::Wait
+// 	Release "conditionLock" and go to sleep until signalled, then
+//	take the lock back.  Interrupts are off from before we join the
+//	queue until we are asleep, so a Signal can't be lost in between.
+//----------------------------------------------------------------------
+
+void
+Condition::Wait(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    queue->Append((void *)currentThread);
+    conditionLock->Release();
+    currentThread->Sleep();
+    conditionLock->Acquire();
+
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Condition::Signal, Condition::Broadcast
+// 	Wake up one, or every, thread waiting on the condition.  The
+//	caller must hold "conditionLock"; the woken threads take it back
+//	once it is released (Mesa semantics).
+//----------------------------------------------------------------------
+
+void
+Condition::Signal(Lock* conditionLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    Signal();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+void
+Condition::Broadcast(Lock* conditionLock)
+{
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    Broadcast();
+}
 
 // The reason why we are not disabling interrupts here is because the
 // condtion variable is protected by a mutex so only one thread can exexute
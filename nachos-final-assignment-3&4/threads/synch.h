@@ -83,7 +83,8 @@ class Lock {
 
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
+    Thread *owner;			// thread holding the lock, NULL if FREE
+    List *queue;			// threads waiting in Acquire()
 };
 
 // The following class defines a "condition variable".  A condition
@@ -19,29 +19,40 @@ Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
 List *freedPages;   // A list of pages freed by SC_Exec
-TranslationEntry *pageEntries[NumPhysPages]; // A hashmap of page entries
+TranslationEntry *pageEntries[NumPhysPages]; // The entries mapping each frame
+int frameRefCount[NumPhysPages];	// How many entries map each frame
+int textHash[TextHashSize];		// Text frames by executable page
+int textFrameNext[NumPhysPages];
+int textFrameExec[NumPhysPages];
+int textFrameVpn[NumPhysPages];
+static char *executableNames[MAX_EXECUTABLES];	// indexed by executableId
+static int numExecutables;
 
 unsigned numPagesAllocated;              // number of physical frames allocated
 unsigned nextUnallocatedPage;
 
 Thread *threadArray[MAX_THREAD_COUNT];  // Array of thread pointers
 unsigned thread_index;			// Index into this array (also used to assign unique pid)
-bool initializedConsoleSemaphores;
 bool exitThreadArray[MAX_THREAD_COUNT];  //Marks exited threads
 
-TimeSortedWaitQueue *sleepQueueHead;	// Needed to implement SC_Sleep
+TimeoutQueue *timeouts;		// Sleeping threads, and other timeouts
 
 int schedulingAlgo;			// Scheduling algorithm to simulate
 int pageAlgo;
+int diskSchedAlgo;			// Order in which disk requests are served
+bool blockExecution;			// Run user code a basic block at a time
 char **batchProcesses;			// Names of batch processes
 int *priority;				// Process priority
 
-TranslationEntry *pageEntries[NumPhysPages]; // A list of pageEntries
-List *pageQueue; 
-int *LRUClockhand; // The clock hand of LRU_CLock
-int referenceBit[NumPhysPages]; // reference bit
+int pageQueueHead, pageQueueTail;	// Frames in replacement order
+int pageQueueNext[NumPhysPages];
+int pageQueuePrev[NumPhysPages];
+bool inPageQueue[NumPhysPages];
+int LRUClockhand; // The clock hand of LRU_CLOCK/WS_CLOCK
+unsigned int referenceBits[divRoundUp(NumPhysPages, 32)]; // reference bits
 
 int cpu_burst_start_time;        // Records the start of current CPU burst
+unsigned priorityEpoch;		// UNIX scheduler priority updates so far
 int completionTimeArray[MAX_THREAD_COUNT];        // Records the completion time of all simulated threads
 bool excludeMainThread;		// Used by completion time statistics calculation
 
@@ -51,10 +62,15 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+BufferCache *bufferCache;	// recently used file system sectors
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+SwapSpace *swapSpace;	// where evicted dirty pages are kept
+Pager *pager;		// does the disk I/O of page faults
+Lock *pagingLock;	// serializes page fault handling
+SynchConsole *synchConsole;	// the console all user programs share
 #endif
 
 #ifdef NETWORK
@@ -86,15 +102,7 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(int dummy)
 {
-    TimeSortedWaitQueue *ptr;
     if (interrupt->getStatus() != IdleMode) {
-        // Check the head of the sleep queue
-        while ((sleepQueueHead != NULL) && (sleepQueueHead->GetWhen() <= (unsigned)stats->totalTicks)) {
-           sleepQueueHead->GetThread()->Schedule();
-           ptr = sleepQueueHead;
-           sleepQueueHead = sleepQueueHead->GetNext();
-           delete ptr;
-        }
         //printf("[%d] Timer interrupt.\n", stats->totalTicks);
         if ((schedulingAlgo == ROUND_ROBIN) || (schedulingAlgo == UNIX_SCHED)) {
            if ((stats->totalTicks - cpu_burst_start_time) >= SCHED_QUANTUM) {
@@ -105,117 +113,288 @@ TimerInterruptHandler(int dummy)
     }
 }
 
-void printQueue() {
-    List *tempList = new List();
-    int *temp;
+//----------------------------------------------------------------------
+// appendToPageQueue
+//      Put "frame" at the tail of the page replacement queue.  The frame
+//      must not already be on the queue.
+//----------------------------------------------------------------------
+void
+appendToPageQueue(int frame)
+{
+    ASSERT(!inPageQueue[frame]);
+    pageQueueNext[frame] = -1;
+    pageQueuePrev[frame] = pageQueueTail;
+    if (pageQueueTail == -1)
+        pageQueueHead = frame;
+    else
+        pageQueueNext[pageQueueTail] = frame;
+    pageQueueTail = frame;
+    inPageQueue[frame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// deleteFromPageQueue
+//      Unlink "frame" from the page replacement queue, if it is on it.
+//----------------------------------------------------------------------
+void
+deleteFromPageQueue(int frame)
+{
+    if (!inPageQueue[frame])
+        return;
+
+    DEBUG('q', "deleting the frame %d from pageQueue\n", frame);
+    if (pageQueuePrev[frame] == -1)
+        pageQueueHead = pageQueueNext[frame];
+    else
+        pageQueueNext[pageQueuePrev[frame]] = pageQueueNext[frame];
+    if (pageQueueNext[frame] == -1)
+        pageQueueTail = pageQueuePrev[frame];
+    else
+        pageQueuePrev[pageQueueNext[frame]] = pageQueuePrev[frame];
+    pageQueueNext[frame] = pageQueuePrev[frame] = -1;
+    inPageQueue[frame] = FALSE;
+
+    DEBUG('Q', "Delete Queue %d\t", frame);
+    printQueue();
+}
+
+//----------------------------------------------------------------------
+// removeFromPageQueue
+//      Take the frame at the head of the page replacement queue off it.
+//      Returns -1 if the queue is empty.
+//----------------------------------------------------------------------
+int
+removeFromPageQueue()
+{
+    int frame = pageQueueHead;
+
+    if (frame != -1)
+        deleteFromPageQueue(frame);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// printQueue
+//      Print the page replacement queue, for debug flag 'Q'.
+//----------------------------------------------------------------------
+void
+printQueue()
+{
+    int frame;
+
+    if (!DebugIsEnabled('Q'))
+        return;
 
     DEBUG('Q', "\n\tThe queue is: \t");
-    temp = (int *)pageQueue->Remove();
-    while( temp != NULL ) {
-        DEBUG('Q', " %d", *temp);
-        tempList->Append((void *)temp);
-        temp = (int *)pageQueue->Remove();
-    }
+    for (frame = pageQueueHead; frame != -1; frame = pageQueueNext[frame])
+        DEBUG('Q', " %d", frame);
 
-    if(pageAlgo == LRU_CLOCK) {
+    if(pageAlgo == LRU_CLOCK || pageAlgo == WS_CLOCK) {
         DEBUG('Q', "\n\tReferenceBit: \t");
         int i;
         for(i=0; i<NumPhysPages;++i){
-            DEBUG('Q', " %d", referenceBit[i]);
-        }
-        if(LRUClockhand != NULL) {
-            DEBUG('Q', "\n\tLRUClockHandle:  %d", *LRUClockhand);
+            DEBUG('Q', " %d", TestReferenceBit(i));
         }
+        DEBUG('Q', "\n\tLRUClockHandle:  %d", LRUClockhand);
         DEBUG('Q', "\n");
     }
+}
 
-    // The pageQueue now is the modified pageQueue
-    delete pageQueue;
-    pageQueue = tempList;
+//----------------------------------------------------------------------
+// addFrameMapping
+//      Record that page table entry "entry" now maps "frame".
+//----------------------------------------------------------------------
+void
+addFrameMapping(int frame, TranslationEntry *entry)
+{
+    entry->nextMapping = pageEntries[frame];
+    pageEntries[frame] = entry;
+    frameRefCount[frame]++;
+    DEBUG('R', "Adding pageEntry for %d, %d mappings\n", frame,
+            frameRefCount[frame]);
 }
 
-// This is a method which implements LRU_CLOCK
-int* getLRUClockFrame() {
-    List *originalList = new List();
-    List *clockList = new List();
-
-    // Firstly we create two copies of the list, one for traversal and the other
-    // one to maintain the fifo order
-    int *temp1;
-    int *temp = (int *)pageQueue->Remove();
-    while( temp != NULL ) {
-        temp1 = new int(*temp);
-        originalList->Append((void *)temp);
-        clockList->Append((void *)temp1);
-        temp = (int *)pageQueue->Remove();
+//----------------------------------------------------------------------
+// removeFrameMapping
+//      Unlink "entry" from the entries mapping "frame".  The frame itself
+//      is not freed; see releaseFrame.
+//----------------------------------------------------------------------
+void
+removeFrameMapping(int frame, TranslationEntry *entry)
+{
+    TranslationEntry **link = &pageEntries[frame];
+
+    while (*link != entry) {
+        ASSERT(*link != NULL);
+        link = &(*link)->nextMapping;
     }
+    *link = entry->nextMapping;
+    entry->nextMapping = NULL;
+    frameRefCount[frame]--;
+    DEBUG('R', "Removing pageEntry for %d, %d mappings\n", frame,
+            frameRefCount[frame]);
+}
 
-    // delete the pageQueue and link it to originalList
-    delete pageQueue;
-    pageQueue = originalList;
+//----------------------------------------------------------------------
+// replaceFrameMapping
+//      Put "newEntry" in the place of "oldEntry" among the entries mapping
+//      "frame", for when a page table is reallocated.
+//----------------------------------------------------------------------
+void
+replaceFrameMapping(int frame, TranslationEntry *oldEntry,
+                    TranslationEntry *newEntry)
+{
+    TranslationEntry **link = &pageEntries[frame];
 
-    // Now we reorder the clock list so that the clockhand is the head
-    temp = (int *)clockList->Remove();
-    while(*temp != *LRUClockhand) {
-        clockList->Append((void *) temp);
-        temp = (int *)clockList->Remove();
+    while (*link != oldEntry) {
+        ASSERT(*link != NULL);
+        link = &(*link)->nextMapping;
     }
+    *link = newEntry;
+    newEntry->nextMapping = oldEntry->nextMapping;
+}
 
-    // Now we run the LRU CLock algorithm to check if we find an element with
-    // reference bit unset
-    int *frameToReplace = NULL;
-    while(1) {
-        if(referenceBit[*temp] == 0) {
-            frameToReplace = new int(*temp);
-            temp = (int *)clockList->Remove();
-            *LRUClockhand = *temp;
-            break;
-        } else {
-            // reset the reference bit
-            referenceBit[*temp] = 0;
-        }
+//----------------------------------------------------------------------
+// releaseFrame
+//      Put a frame that no entry maps any more back in the free pool.
+//----------------------------------------------------------------------
+void
+releaseFrame(int frame)
+{
+    ASSERT(pageEntries[frame] == NULL);
+    DEBUG('A', "Freeing page %d\n", frame);
+    removeTextFrame(frame);
+    freedPages->Append((void *)new int(frame));
+    deleteFromPageQueue(frame);
+    numPagesAllocated--;
+}
 
-        // Add this element back to the clocklist
-        clockList->Append((void *)temp);
+//----------------------------------------------------------------------
+// executableId
+//      Return the number standing for the executable "name", giving it
+//      the next free number if it has none yet.
+//----------------------------------------------------------------------
+int
+executableId(char *name)
+{
+    int i;
 
-        // delete temp and move forward
-        temp = (int *)clockList->Remove();
-    }
+    for (i = 0; i < numExecutables; i++)
+        if (!strcmp(executableNames[i], name))
+            return i;
 
-    // delete the clockList
-    temp = (int *)clockList->Remove();
-    while(temp != NULL) {
-        delete temp;
-        temp = (int *)clockList->Remove();
-    }
-    delete clockList;
+    ASSERT(numExecutables < MAX_EXECUTABLES);
+    executableNames[i] = new char[strlen(name) + 1];
+    strcpy(executableNames[i], name);
+    numExecutables++;
+    return i;
+}
+
+static int
+textHashBucket(int execId, int vpn)
+{
+    return (execId * 31 + vpn) % TextHashSize;
+}
+
+//----------------------------------------------------------------------
+// findTextFrame
+//      Return the frame holding text page "vpn" of executable "execId",
+//      or -1 if no process has it in memory.
+//----------------------------------------------------------------------
+int
+findTextFrame(int execId, int vpn)
+{
+    int frame;
+
+    for (frame = textHash[textHashBucket(execId, vpn)]; frame != -1;
+            frame = textFrameNext[frame])
+        if (textFrameExec[frame] == execId && textFrameVpn[frame] == vpn)
+            return frame;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// addTextFrame
+//      Record that "frame" holds text page "vpn" of executable "execId".
+//----------------------------------------------------------------------
+void
+addTextFrame(int frame, int execId, int vpn)
+{
+    int bucket = textHashBucket(execId, vpn);
+
+    ASSERT(textFrameExec[frame] == -1);
+    textFrameExec[frame] = execId;
+    textFrameVpn[frame] = vpn;
+    textFrameNext[frame] = textHash[bucket];
+    textHash[bucket] = frame;
+}
+
+//----------------------------------------------------------------------
+// removeTextFrame
+//      Forget the text page in "frame", when the frame is evicted or
+//      freed.  Does nothing if the frame holds no text.
+//----------------------------------------------------------------------
+void
+removeTextFrame(int frame)
+{
+    int *link;
+
+    if (textFrameExec[frame] == -1)
+        return;
 
-    // return the frame to replace
-    return frameToReplace;
+    link = &textHash[textHashBucket(textFrameExec[frame], textFrameVpn[frame])];
+    while (*link != frame)
+        link = &textFrameNext[*link];
+    *link = textFrameNext[frame];
+    textFrameExec[frame] = -1;
 }
 
-// This method is used to delete an element from the FIFO Queue
-void deleteFromPageQueue(int value) {
-    List *tempList = new List();
-    int *temp;
-
-    temp = (int *)pageQueue->Remove();
-    while( temp != NULL ) {
-        if(*temp == value) {
-            DEBUG('q', "deleting the frame %d from pageQueue\n", *temp);
-            delete temp;
-        } else {
-            tempList->Append((void *)temp);
+//----------------------------------------------------------------------
+// getClockFrame
+//      Select a victim for LRU_CLOCK or WS_CLOCK.  The ring is simply the
+//      array of physical frames, swept from LRUClockhand; frames that hold
+//      no page are skipped, and referenced frames get their bit cleared
+//      (a second chance).  The hand is left just past the victim.
+//
+//      With "preferClean" (WS_CLOCK), an unreferenced frame is only taken
+//      if it is clean, since evicting a dirty one costs a write back.  If
+//      a whole revolution finds no clean frame, the first unreferenced
+//      dirty frame seen is used.  A frame is dirty if any of the entries
+//      mapping it is.
+//----------------------------------------------------------------------
+int
+getClockFrame(bool preferClean)
+{
+    int scanned, frame, dirtyFrame = -1;
+    TranslationEntry *entry;
+
+    for (scanned = 0; scanned < 2 * NumPhysPages; scanned++) {
+        if (scanned == NumPhysPages && dirtyFrame != -1)
+            break;
+        frame = LRUClockhand;
+        LRUClockhand = (LRUClockhand + 1) % NumPhysPages;
+
+        if (pageEntries[frame] == NULL)
+            continue;
+        if (TestReferenceBit(frame)) {
+            ClearReferenceBit(frame);
+            continue;
         }
-        temp = (int *)pageQueue->Remove();
+        if (!preferClean)
+            return frame;
+        for (entry = pageEntries[frame]; entry != NULL; entry = entry->nextMapping)
+            if (entry->dirty)
+                break;
+        if (entry == NULL)
+            return frame;
+        if (dirtyFrame == -1)
+            dirtyFrame = frame;
     }
 
-    // The pageQueue now is the modified pageQueue
-    delete pageQueue;
-    pageQueue = tempList;
-
-    DEBUG('Q', "Delete Queue %d\t", value);
-    printQueue();
+    ASSERT(dirtyFrame != -1);
+    DEBUG('R', "\n\tno clean frame, falling back on dirty frame %d", dirtyFrame);
+    LRUClockhand = (dirtyFrame + 1) % NumPhysPages;
+    return dirtyFrame;
 }
 
 //----------------------------------------------------------------------
@@ -235,7 +414,6 @@ Initialize(int argc, char **argv)
     char* debugArgs = "";
     bool randomYield = FALSE;
 
-    initializedConsoleSemaphores = false;
     numPagesAllocated = 0;
     nextUnallocatedPage = 0;
 
@@ -244,11 +422,22 @@ Initialize(int argc, char **argv)
 
     schedulingAlgo = NON_PREEMPTIVE_BASE;	// Default
     pageAlgo = NORMAL;
-    pageQueue = new List();
-
+    diskSchedAlgo = DISK_CLOOK;
+    blockExecution = FALSE;
+    pageQueueHead = pageQueueTail = -1;
+    LRUClockhand = 0;
+
+    for(i=0; i<divRoundUp(NumPhysPages, 32); ++i)
+        referenceBits[i] = 0;
+    for(i=0; i<TextHashSize; ++i)
+        textHash[i] = -1;
+    numExecutables = 0;
     for(i=0; i<NumPhysPages; ++i) {
         pageEntries[i] = NULL;
-        referenceBit[i] = 0;
+        frameRefCount[i] = 0;
+        textFrameExec[i] = -1;
+        pageQueueNext[i] = pageQueuePrev[i] = -1;
+        inPageQueue[i] = FALSE;
     }
 
     batchProcesses = new char*[MAX_BATCH_SIZE];
@@ -265,8 +454,9 @@ Initialize(int argc, char **argv)
 
     for (i=0; i<MAX_THREAD_COUNT; i++) { threadArray[i] = NULL; exitThreadArray[i] = false; completionTimeArray[i] = -1; }
     thread_index = 0;
+    priorityEpoch = 0;
 
-    sleepQueueHead = NULL;
+    timeouts = new TimeoutQueue;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -294,6 +484,11 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-S")) {	// disk scheduling algorithm
+	    ASSERT(argc > 1);
+	    diskSchedAlgo = atoi(*(argv + 1));
+	    ASSERT((diskSchedAlgo >= DISK_FCFS) && (diskSchedAlgo <= DISK_SSTF));
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
@@ -339,10 +534,15 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    swapSpace = new SwapSpace("SWAP");
+    pager = new Pager;
+    pagingLock = new Lock("paging lock");
+    synchConsole = new SynchConsole;
 #endif
 
 #ifdef FILESYS
     synchDisk = new SynchDisk("DISK");
+    bufferCache = new BufferCache;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -367,6 +567,10 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete synchConsole;
+    delete pagingLock;
+    delete pager;
+    delete swapSpace;
     delete machine;
 #endif
 
@@ -375,10 +579,12 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete bufferCache;
     delete synchDisk;
 #endif
     
     delete timer;
+    delete timeouts;
     delete scheduler;
     delete interrupt;
     
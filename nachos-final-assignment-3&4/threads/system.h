@@ -15,9 +15,11 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "timeout.h"
 
 #define MAX_THREAD_COUNT 1000
 #define MAX_BATCH_SIZE 100
+#define MAX_EXECUTABLES 100	// distinct executables whose text is shared
 
 // Scheduling algorithms
 #define NON_PREEMPTIVE_BASE 	1
@@ -31,6 +33,15 @@
 #define FIFO 2
 #define LRU 3
 #define LRU_CLOCK 4
+#define WS_CLOCK 5	// clock that prefers clean victims
+
+// Disk scheduling algorithms
+#define DISK_FCFS	0	// in the order requests were made
+#define DISK_SCAN	1	// elevator, turning at the last request
+#define DISK_CLOOK	2	// upwards only, then back to the lowest
+#define DISK_SSTF	3	// shortest seek first
+
+#define MAX_PAGE_CLUSTER	8		// Most pages read from the executable on one fault
 
 #define SCHED_QUANTUM		100		// If not a multiple of timer interval, quantum will overshoot
 
@@ -56,50 +67,84 @@ extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
 extern unsigned numPagesAllocated;		// number of physical frames allocated
 extern unsigned nextUnallocatedPage; // This stores the next unallocated Page
-extern int *LRUClockhand; // The clock hand of LRU_CLock
+extern int LRUClockhand; // The clock hand of LRU_CLOCK/WS_CLOCK, a frame number
 
 extern Thread *threadArray[];  // Array of thread pointers
 extern unsigned thread_index;                  // Index into this array (also used to assign unique pid)
-extern bool initializedConsoleSemaphores;	// Used to initialize the semaphores for console I/O exactly once
 extern bool exitThreadArray[];		// Marks exited threads
 
 extern int schedulingAlgo;		// Scheduling algorithm to simulate
 extern int pageAlgo;
+extern int diskSchedAlgo;		// Order in which disk requests are served
+extern bool blockExecution;		// Run user code a basic block at a time
 extern char **batchProcesses;		// Names of batch executables
 extern int *priority;			// Process priority
-extern TranslationEntry *pageEntries[NumPhysPages]; // A list of pageEntries
-extern List* pageQueue ; // This is a list of pages in page replacement 
+
+// Every page table entry that maps a frame, chained through nextMapping.
+// More than one entry maps a frame after a copy-on-write fork, and for
+// shared memory.
+extern TranslationEntry *pageEntries[NumPhysPages]; // NULL if frame unmapped
+extern int frameRefCount[NumPhysPages];		// length of each chain
+
+extern void addFrameMapping(int frame, TranslationEntry *entry);
+extern void removeFrameMapping(int frame, TranslationEntry *entry);
+extern void replaceFrameMapping(int frame, TranslationEntry *oldEntry,
+				TranslationEntry *newEntry);
+extern void releaseFrame(int frame);		// give back an unmapped frame
+
+// Frames holding a text page of an executable, hashed by executable and
+// virtual page, so that every process running the executable maps the
+// same read-only frame.
+#define TextHashSize NumPhysPages
+extern int textHash[TextHashSize];		// first frame in each bucket
+extern int textFrameNext[NumPhysPages];	// -1 at the end of a bucket
+extern int textFrameExec[NumPhysPages];	// -1 if the frame holds no text
+extern int textFrameVpn[NumPhysPages];
+
+extern int executableId(char *name);		// small integer naming "name"
+extern int findTextFrame(int execId, int vpn);	// -1 if not in memory
+extern void addTextFrame(int frame, int execId, int vpn);
+extern void removeTextFrame(int frame);	// no-op if frame holds no text
+
+// The frames under FIFO/LRU replacement, in queue order.  This
+// is a doubly linked list threaded through per-frame arrays, so that
+// appending, removing and moving a frame to the tail are all O(1).
+extern int pageQueueHead, pageQueueTail;	// -1 if the queue is empty
+extern int pageQueueNext[NumPhysPages];		// -1 at the tail
+extern int pageQueuePrev[NumPhysPages];		// -1 at the head
+extern bool inPageQueue[NumPhysPages];
+
+extern void appendToPageQueue(int frame);	// add "frame" at the tail
+extern int removeFromPageQueue();		// pop the head, -1 if empty
+extern void deleteFromPageQueue(int frame);	// unlink "frame" if queued
+extern void printQueue();			// dump the queue (debug 'Q')
+extern int getClockFrame(bool preferClean);	// LRU_CLOCK/WS_CLOCK victim
 
 extern int cpu_burst_start_time;	// Records the start of current CPU burst
+extern unsigned priorityEpoch;		// UNIX scheduler priority updates so far
 extern int completionTimeArray[];	// Records the completion time of all simulated threads
 extern bool excludeMainThread;		// Used by completion time statistics calculation
 extern List *freedPages;            // A list of pages freed by SC_Exec
-extern int referenceBit[NumPhysPages]; // An array of reference bits of the pageFrames
-
-// This maintains a hashMap of pageTable entries
-extern TranslationEntry *pageEntries[NumPhysPages];
-
-class TimeSortedWaitQueue {		// Needed to implement SC_Sleep
-private:
-   Thread *t;				// Thread pointer of the sleeping thread
-   unsigned when;			// When to wake up
-   TimeSortedWaitQueue *next;		// Build the list
 
-public:
-   TimeSortedWaitQueue (Thread *th,unsigned w) { t = th; when = w; next = NULL; }
-   ~TimeSortedWaitQueue (void) {}
-   
-   Thread *GetThread (void) { return t; }
-   unsigned GetWhen (void) { return when; }
-   TimeSortedWaitQueue *GetNext(void) { return next; }
-   void SetNext (TimeSortedWaitQueue *n) { next = n; }
-};
+// Reference bits of the page frames for the clock algorithms, one bit
+// per frame packed into words; a touch is a single bit set.
+extern unsigned int referenceBits[divRoundUp(NumPhysPages, 32)];
+#define SetReferenceBit(frame)	 (referenceBits[(frame) >> 5] |= (1U << ((frame) & 31)))
+#define ClearReferenceBit(frame) (referenceBits[(frame) >> 5] &= ~(1U << ((frame) & 31)))
+#define TestReferenceBit(frame)	 ((referenceBits[(frame) >> 5] >> ((frame) & 31)) & 1)
 
-extern TimeSortedWaitQueue *sleepQueueHead;
+extern TimeoutQueue *timeouts;		// Sleeping threads, and other timeouts
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "swap.h"
+#include "pager.h"
+#include "synchconsole.h"
 extern Machine* machine;	// user program memory and registers
+extern SwapSpace *swapSpace;	// where evicted dirty pages are kept
+extern Pager *pager;		// does the disk I/O of page faults
+extern Lock *pagingLock;	// serializes page fault handling
+extern SynchConsole *synchConsole;	// the console all user programs share
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -109,7 +154,9 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "bufcache.h"
 extern SynchDisk   *synchDisk;
+extern BufferCache *bufferCache;	// recently used file system sectors
 #endif
 
 #ifdef NETWORK
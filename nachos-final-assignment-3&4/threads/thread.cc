@@ -19,6 +19,9 @@
 #include "switch.h"
 #include "synch.h"
 #include "system.h"
+#ifdef USER_PROGRAM
+#include "filetable.h"
+#endif
 
 #define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
 					// execution stack, for detecting 
@@ -29,9 +32,13 @@
 //	Thread::Fork.
 //
 //	"threadName" is an arbitrary string, useful for debugging.
+//	"daemon" is TRUE for a kernel thread that serves the others, such
+//	as the pager.  It gets no pid, so it is not in threadArray: it
+//	neither counts as a thread in the statistics nor keeps the
+//	simulation from ending when every process has exited.
 //----------------------------------------------------------------------
 
-Thread::Thread(char* threadName, int nice)
+Thread::Thread(char* threadName, int nice, bool daemon)
 {
     int i;
 
@@ -42,18 +49,25 @@ Thread::Thread(char* threadName, int nice)
     status = JUST_CREATED;
 #ifdef USER_PROGRAM
     space = NULL;
+    files = NULL;
 #endif
 
-    threadArray[thread_index] = this;
-    pid = thread_index;
-    thread_index++;
-    stats->numTotalThreads = thread_index;
-    ASSERT(thread_index < MAX_THREAD_COUNT);
-    if (currentThread != NULL) {
-       ppid = currentThread->GetPID();
-       currentThread->RegisterNewChild (pid);
+    if (daemon) {
+       pid = -1;
+       ppid = -1;
+    }
+    else {
+       threadArray[thread_index] = this;
+       pid = thread_index;
+       thread_index++;
+       stats->numTotalThreads = thread_index;
+       ASSERT(thread_index < MAX_THREAD_COUNT);
+       if (currentThread != NULL) {
+          ppid = currentThread->GetPID();
+          currentThread->RegisterNewChild (pid);
+       }
+       else ppid = -1;
     }
-    else ppid = -1;
 
     childcount = 0;
     waitchild_id = -1;
@@ -73,6 +87,8 @@ Thread::Thread(char* threadName, int nice)
     }
     schedPriority = basePriority;
     usage = 0;
+    usageEpoch = priorityEpoch;
+    readyIndex = -1;
 
     if (schedulingAlgo == NON_PREEMPTIVE_SJF) schedPriority = INITIAL_TAU;
 }
@@ -267,6 +283,12 @@ Thread::Exit (bool terminateSim, int exitcode)
        }
     }
 
+#ifdef USER_PROGRAM
+    // Close the files the process still has open
+    delete files;
+    files = NULL;
+#endif
+
     // Free the pages associated with this thread
     if(pageAlgo != NORMAL) {
         currentThread->space->freePages(FALSE);
@@ -580,54 +602,6 @@ Thread::Startup()
    scheduler->Tail();
 }
 
-//----------------------------------------------------------------------
-// Thread::SortedInsertInWaitQueue
-//      Called by SC_Sleep before putting the caller thread to sleep
-//----------------------------------------------------------------------
-
-void
-Thread::SortedInsertInWaitQueue (unsigned when)
-{
-   TimeSortedWaitQueue *ptr, *prev, *temp;
-
-   if (sleepQueueHead == NULL) {
-      sleepQueueHead = new TimeSortedWaitQueue (this, when);
-      ASSERT(sleepQueueHead != NULL);
-   }
-   else {
-      ptr = sleepQueueHead;
-      prev = NULL;
-      while ((ptr != NULL) && (ptr->GetWhen() <= when)) {
-         prev = ptr;
-         ptr = ptr->GetNext();
-      }
-      if (ptr == NULL) {  // Insert at tail
-         ptr = new TimeSortedWaitQueue (this, when);
-         ASSERT(ptr != NULL);
-         ASSERT(prev->GetNext() == NULL);
-         prev->SetNext(ptr);
-      }
-      else if (prev == NULL) {  // Insert at head
-         ptr = new TimeSortedWaitQueue (this, when);
-         ASSERT(ptr != NULL);
-         ptr->SetNext(sleepQueueHead);
-         sleepQueueHead = ptr;
-      }
-      else {
-         temp = new TimeSortedWaitQueue (this, when);
-         ASSERT(temp != NULL);
-         temp->SetNext(ptr);
-         prev->SetNext(temp);
-      }
-   }
-
-   IntStatus oldLevel = interrupt->SetLevel(IntOff);
-   //printf("[pid %d] Going to sleep at %d.\n", pid, stats->totalTicks);
-   Sleep();
-   //printf("[pid %d] Returned from sleep at %d.\n", pid, stats->totalTicks);
-   (void) interrupt->SetLevel(oldLevel);
-}
-
 void
 Thread::SetWaitStartTime (int ticks)
 {
@@ -682,6 +656,7 @@ void
 Thread::SetUsage (int u)
 {
    usage = u;
+   usageEpoch = priorityEpoch;
 }
     
 int 
@@ -690,8 +665,23 @@ Thread::GetUsage (void)
    return usage;
 }
 
-void 
-Thread::initBackupMemory(int size) {
-    backupMemory = new char[size];
+//----------------------------------------------------------------------
+// Thread::DecayUsage
+//	Every epoch of the UNIX scheduler halves the usage of all the
+//	threads but the one that ran, and sets their priority from it.
+//	Rather than visit every thread each epoch, a thread takes all the
+//	halvings it has missed at once, when it is next looked at.
+//----------------------------------------------------------------------
+
+void
+Thread::DecayUsage (void)
+{
+   unsigned missed = priorityEpoch - usageEpoch;
+
+   if (missed == 0) return;
+   if (missed >= 32) usage = 0;
+   else usage = usage >> missed;
+   schedPriority = basePriority + (usage >> 1);
+   usageEpoch = priorityEpoch;
 }
 #endif
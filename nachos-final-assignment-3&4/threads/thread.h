@@ -45,6 +45,8 @@
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "addrspace.h"
+
+class FileTable;
 #endif
 
 // CPU register state to be saved on context switch.  
@@ -83,7 +85,10 @@ class Thread {
     int machineState[MachineStateSize];  // all registers except for stackTop
 
   public:
-    Thread(char* debugName, int nice);		// initialize a Thread 
+    Thread(char* debugName, int nice, bool daemon = FALSE);
+					// initialize a Thread; a daemon
+					// is a kernel thread that is not
+					// a process (no pid, never exits)
     ~Thread(); 				// deallocate a Thread
 					// NOTE -- thread being deleted
 					// must not be running when delete 
@@ -132,7 +137,6 @@ class Thread {
 
     void Startup();					// Called by the startup function of SC_Fork to cleanly start a forked child after it is scheduled
 
-    void SortedInsertInWaitQueue (unsigned when);	// Called by SC_Sleep handler
 
     void SetWaitStartTime (int ticks);
     int GetWaitStartTime (void);
@@ -148,6 +152,11 @@ class Thread {
 
     void SetUsage (int usage);
     int GetUsage (void);
+    void DecayUsage (void);		// Catch up with priorityEpoch
+
+    int readyIndex;			// Position on a PriorityReadyQueue,
+					// -1 if not on one
+    unsigned readyArrival;		// When it last became ready
     char *pageCache; // This caches the pages in case of replacement
     void initPageCache(int cacheSize); 
 
@@ -175,6 +184,7 @@ class Thread {
 
     int basePriority, schedPriority, usage;	// Used by the UNIX scheduler
 						// schedPriority is also used to store the next burst estimate
+    unsigned usageEpoch;		// priorityEpoch when usage was last current
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -188,9 +198,8 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
-
-    char *backupMemory; // the backup of pages
-    void initBackupMemory(int size);
+    FileTable *files;			// Files the process has open; NULL
+					// until it first opens one
 #endif
 };
 
@@ -0,0 +1,252 @@
+// timeout.cc
+//	Routines to set and cancel kernel timeouts, and to run them when
+//	they are due.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include <limits.h>
+
+#include "copyright.h"
+#include "timeout.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// Timeout::Timeout
+// 	Initialize a timeout that is not set yet.
+//
+//	"func" is the procedure to call when the timeout expires
+//	"param" is the argument to pass to the procedure
+//----------------------------------------------------------------------
+
+Timeout::Timeout(VoidFunctionPtr func, int param)
+{
+    handler = func;
+    arg = param;
+    when = 0;
+    order = 0;
+    index = -1;
+}
+
+//----------------------------------------------------------------------
+// TimeoutInterrupt
+// 	Interrupt handler for the TimeoutInt the queue schedules.
+//
+//	"queue" is the TimeoutQueue, cast to an int
+//----------------------------------------------------------------------
+
+static void
+TimeoutInterrupt(int queue)
+{
+    ((TimeoutQueue *)queue)->Expire();
+}
+
+//----------------------------------------------------------------------
+// WakeUp
+// 	The handler of the timeout a thread sleeps on: put it back on
+//	the ready list.
+//----------------------------------------------------------------------
+
+static void
+WakeUp(int thread)
+{
+    scheduler->ReadyToRun((Thread *)thread);
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::TimeoutQueue
+// 	Initialize an empty queue.  The heap grows as needed.
+//----------------------------------------------------------------------
+
+TimeoutQueue::TimeoutQueue()
+{
+    capacity = 16;
+    heap = new Timeout *[capacity];
+    size = 0;
+    settings = 0;
+    armedFor = INT_MAX;
+}
+
+TimeoutQueue::~TimeoutQueue()
+{
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::Before, TimeoutQueue::Place, TimeoutQueue::SiftUp,
+//	TimeoutQueue::SiftDown
+// 	Heap maintenance.  A timeout comes before another if it is due
+//	earlier, or at the same time but was set earlier.
+//----------------------------------------------------------------------
+
+bool
+TimeoutQueue::Before(Timeout *a, Timeout *b)
+{
+    if (a->when != b->when)
+	return (a->when < b->when);
+    return (a->order < b->order);
+}
+
+void
+TimeoutQueue::Place(Timeout *timeout, int index)
+{
+    heap[index] = timeout;
+    timeout->index = index;
+}
+
+void
+TimeoutQueue::SiftUp(int index)
+{
+    Timeout *timeout = heap[index];
+
+    while (index > 0 && Before(timeout, heap[(index - 1) / 2])) {
+	Place(heap[(index - 1) / 2], index);
+	index = (index - 1) / 2;
+    }
+    Place(timeout, index);
+}
+
+void
+TimeoutQueue::SiftDown(int index)
+{
+    Timeout *timeout = heap[index];
+    int child;
+
+    for (;;) {
+	child = 2 * index + 1;
+	if (child >= size)
+	    break;
+	if (child + 1 < size && Before(heap[child + 1], heap[child]))
+	    child++;
+	if (!Before(heap[child], timeout))
+	    break;
+	Place(heap[child], index);
+	index = child;
+    }
+    Place(timeout, index);
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::Arm
+// 	Make sure a TimeoutInt is due no later than the earliest pending
+//	timeout.  A TimeoutInt that turns out to be early, because its
+//	timeout was cancelled, finds nothing to do and re-arms.
+//----------------------------------------------------------------------
+
+void
+TimeoutQueue::Arm()
+{
+    if ((size == 0) || (heap[0]->when >= armedFor))
+	return;
+    armedFor = heap[0]->when;
+    interrupt->Schedule(TimeoutInterrupt, (int)this,
+			armedFor - stats->totalTicks, TimeoutInt);
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::Set
+// 	Arrange for "timeout" to run at simulated time "when", in
+//	O(log n).  Timeouts due at the same time run in the order they
+//	were set.
+//----------------------------------------------------------------------
+
+void
+TimeoutQueue::Set(Timeout *timeout, int when)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Timeout **bigger;
+    int i;
+
+    ASSERT(!timeout->IsPending());
+    ASSERT(when > stats->totalTicks);
+    if (size == capacity) {
+	bigger = new Timeout *[2 * capacity];
+	for (i = 0; i < size; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	capacity *= 2;
+    }
+    timeout->when = when;
+    timeout->order = settings++;
+    Place(timeout, size++);
+    SiftUp(size - 1);
+    Arm();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::Cancel
+// 	Take "timeout" off the queue before it runs, in O(log n).
+//	Returns FALSE if it was not pending (it has already run).
+//----------------------------------------------------------------------
+
+bool
+TimeoutQueue::Cancel(Timeout *timeout)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int index = timeout->index;
+    Timeout *moved;
+
+    if (index < 0) {
+	(void) interrupt->SetLevel(oldLevel);
+	return FALSE;
+    }
+    ASSERT(index < size && heap[index] == timeout);
+    timeout->index = -1;
+    size--;
+    if (index < size) {
+	moved = heap[size];
+	Place(moved, index);
+	SiftUp(index);
+	SiftDown(moved->index);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::Expire
+// 	Run every timeout that is due, earliest first, and arm the
+//	TimeoutInt for the next one.  Called from the interrupt handler,
+//	so interrupts are off.
+//----------------------------------------------------------------------
+
+void
+TimeoutQueue::Expire()
+{
+    Timeout *timeout;
+
+    if (stats->totalTicks >= armedFor)
+	armedFor = INT_MAX;		// that was the one armed
+    while ((size > 0) && (heap[0]->when <= stats->totalTicks)) {
+	timeout = heap[0];
+	timeout->index = -1;
+	size--;
+	if (size > 0) {
+	    Place(heap[size], 0);
+	    SiftDown(0);
+	}
+	(*timeout->handler)(timeout->arg);
+    }
+    Arm();
+}
+
+//----------------------------------------------------------------------
+// TimeoutQueue::SleepUntil
+// 	Put currentThread to sleep until simulated time "when".  The
+//	timeout lives on the sleeping thread's stack, so nothing is
+//	allocated.
+//----------------------------------------------------------------------
+
+void
+TimeoutQueue::SleepUntil(int when)
+{
+    Timeout wakeup(WakeUp, (int)currentThread);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    Set(&wakeup, when);
+    currentThread->Sleep();
+    (void) interrupt->SetLevel(oldLevel);
+}
@@ -0,0 +1,81 @@
+// timeout.h
+//	Data structures for kernel timeouts: calls to be made when the
+//	simulated clock reaches a given time, unless they are cancelled
+//	first.  Sleeping threads (SC_Sleep, the page fault latency) are
+//	timeouts that put the thread back on the ready list; timed waits
+//	on semaphores and conditions would be timeouts that are cancelled
+//	when the wait ends some other way.
+//
+//	The pending timeouts are kept in a binary heap on their time, so
+//	setting and cancelling one is O(log n).  The queue keeps a
+//	TimeoutInt scheduled with the interrupt simulation for the
+//	earliest of them, as if the machine had a one-shot alarm clock,
+//	so each one runs at exactly the tick it is due.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TIMEOUT_H
+#define TIMEOUT_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// A call to be made at a given time.  The caller owns the Timeout;
+// it must stay allocated, and must not be set again, until it has
+// either run or been cancelled.
+
+class Timeout {
+  public:
+    Timeout(VoidFunctionPtr func, int param);	// "func(param)" is
+					// called, with interrupts off,
+					// when the timeout expires
+
+    bool IsPending() { return (index >= 0); }
+    int GetWhen() { return when; }
+
+  private:
+    VoidFunctionPtr handler;
+    int arg;
+    int when;				// when to call handler
+    unsigned order;			// tie break, in order of setting
+    int index;				// position in the TimeoutQueue
+					// heap, -1 if not pending
+
+    friend class TimeoutQueue;
+};
+
+// The pending timeouts.
+
+class TimeoutQueue {
+  public:
+    TimeoutQueue();
+    ~TimeoutQueue();			// the Timeouts are not deleted
+
+    void Set(Timeout *timeout, int when);	// Call the timeout at
+					// simulated time "when"
+    bool Cancel(Timeout *timeout);	// Take a pending timeout off the
+					// queue; FALSE if it already ran
+    void SleepUntil(int when);		// Block currentThread until "when"
+
+    void Expire();			// Run the timeouts that are due;
+					// called by the TimeoutInt handler
+
+  private:
+    Timeout **heap;			// heap[0] is due first
+    int size;				// number of pending timeouts
+    int capacity;			// entries allocated in "heap"
+    unsigned settings;			// counts Set calls, for the tie break
+    int armedFor;			// time of the earliest TimeoutInt
+					// scheduled, INT_MAX if none
+
+    bool Before(Timeout *a, Timeout *b);	// is "a" due before "b"?
+    void Place(Timeout *timeout, int index);
+    void SiftUp(int index);
+    void SiftDown(int index);
+    void Arm();				// make sure a TimeoutInt is
+					// scheduled for heap[0]
+};
+
+#endif // TIMEOUT_H
@@ -21,7 +21,8 @@
 #endif
 #endif
 
-static char *enableFlags = NULL; // controls which DEBUG messages are printed 
+unsigned long long debugMask = 0;	// controls which DEBUG messages
+					// are printed
 
 //----------------------------------------------------------------------
 // DebugInit
@@ -37,39 +38,29 @@ static char *enableFlags = NULL; // controls which DEBUG messages are printed
 void
 DebugInit(char *flagList)
 {
-    enableFlags = flagList;
+    debugMask = 0;
+    if (flagList == NULL)
+	return;
+    for (; *flagList != '\0'; flagList++)
+	if (*flagList == '+')
+	    debugMask = ~0ULL;
+	else
+	    debugMask |= DebugBit(*flagList);
 }
 
 //----------------------------------------------------------------------
-// DebugIsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
-
-bool
-DebugIsEnabled(char flag)
-{
-    if (enableFlags != NULL)
-       return (strchr(enableFlags, flag) != 0) 
-		|| (strchr(enableFlags, '+') != 0);
-    else
-      return FALSE;
-}
-
-//----------------------------------------------------------------------
-// DEBUG
-//      Print a debug message, if flag is enabled.  Like printf,
-//	only with an extra argument on the front.
+// DebugPrint
+//      Print a debug message; the DEBUG macro has checked its flag.
+//	Like printf.
 //----------------------------------------------------------------------
 
 void 
-DEBUG(char flag, char *format, ...)
+DebugPrint(char *format, ...)
 {
-    if (DebugIsEnabled(flag)) {
-	va_list ap;
-	// You will get an unused variable message here -- ignore it.
-	va_start(ap, format);
-	vfprintf(stdout, format, ap);
-	va_end(ap);
-	fflush(stdout);
-    }
+    va_list ap;
+    // You will get an unused variable message here -- ignore it.
+    va_start(ap, format);
+    vfprintf(stdout, format, ap);
+    va_end(ap);
+    fflush(stdout);
 }
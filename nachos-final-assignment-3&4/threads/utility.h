@@ -14,6 +14,7 @@
 //   	'd' -- disk emulation (FILESYS)
 //   	'f' -- file system (FILESYS)
 //   	'a' -- address spaces (USER_PROGRAM)
+//   	'c' -- console driver (USER_PROGRAM)
 //   	'n' -- network emulation (NETWORK)
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -65,13 +66,42 @@ typedef void (*VoidNoArgFunctionPtr)();
 #include "sysdep.h"				
 
 // Interface to debugging routines.
+//
+// Debug flags are letters.  The enabled ones are kept as a bit mask,
+// so that DebugIsEnabled is one test, made in line; DEBUG is a macro,
+// so that when its flag is not enabled, its arguments are not even
+// evaluated.
+//
+// Flags can also be compiled out: DEBUG_STRIPPED is the mask of those
+// that are, and for them DebugIsEnabled is a constant FALSE, so no
+// code is generated.  -DNO_DEBUG (as "make release" does) strips them
+// all; -DDEBUG_STRIPPED="DebugBit('m')|DebugBit('i')" strips a few.
+
+#define DebugBit(flag)	(1ULL << ((flag) & 63))	// the bit of "flag"
+
+#ifndef DEBUG_STRIPPED
+#ifdef NO_DEBUG
+#define DEBUG_STRIPPED	(~0ULL)
+#else
+#define DEBUG_STRIPPED	0ULL
+#endif
+#endif
+
+extern unsigned long long debugMask;	// the flags that are enabled
 
 extern void DebugInit(char* flags);	// enable printing debug messages
 
-extern bool DebugIsEnabled(char flag); 	// Is this debug flag enabled?
+#define DebugIsEnabled(flag)		/* Is this debug flag enabled? */ \
+    ((((DEBUG_STRIPPED) & DebugBit(flag)) == 0)				\
+	&& ((debugMask & DebugBit(flag)) != 0))
+
+extern void DebugPrint(char* format, ...);	// Print a debug message
 
-extern void DEBUG (char flag, char* format, ...);  	// Print debug message 
-							// if flag is enabled
+#define DEBUG(flag, ...)		/* Print debug message */	\
+    do {				/* if flag is enabled */	\
+	if (DebugIsEnabled(flag))					\
+	    DebugPrint(__VA_ARGS__);					\
+    } while (0)
 
 //----------------------------------------------------------------------
 // ASSERT
@@ -41,6 +41,27 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// SegmentsEnd
+// 	The virtual address just past the last segment of the program.
+//	The data is laid out on a page boundary, so this can be more than
+//	the sum of the segment sizes; the stack goes after it.
+//----------------------------------------------------------------------
+
+static unsigned
+SegmentsEnd (NoffHeader *noffH)
+{
+	unsigned end = 0;
+
+	if (noffH->code.size > 0)
+	    end = max(end, (unsigned)(noffH->code.virtualAddr + noffH->code.size));
+	if (noffH->initData.size > 0)
+	    end = max(end, (unsigned)(noffH->initData.virtualAddr + noffH->initData.size));
+	if (noffH->uninitData.size > 0)
+	    end = max(end, (unsigned)(noffH->uninitData.virtualAddr + noffH->uninitData.size));
+	return end;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -54,13 +75,25 @@ SwapHeader (NoffHeader *noffH)
 //	only uniprogramming, and we have a single unsegmented page table
 //
 //	"executable" is the file containing the object code to load into memory
+//	"name" is its name, used to reload pages and to share text
+//	"threadPid" is the thread that will run in this address space
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executable, char *name, int threadPid)
 {
+    strcpy(filename, name);
+    execId = executableId(filename);
+    textPages = filePages = 0;
+    executableFile = NULL;
+    clusterSize = 1;
+    nextClusterVpn = 0;
+
     if(pageAlgo != NORMAL) {
         unsigned int i, size;
-        int threadPid = currentThread->GetPID();
+
+        // Pages are loaded on demand; keep our own handle on the file
+        executableFile = fileSystem->Open(filename);
+        ASSERT(executableFile != NULL);
 
         executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
         if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -68,8 +101,28 @@ AddrSpace::AddrSpace(OpenFile *executable)
             SwapHeader(&noffH);
         ASSERT(noffH.noffMagic == NOFFMAGIC);
 
+        // The pages up to the first one holding data are pure text; they
+        // are never written, so one frame can serve every process running
+        // this executable.  coff2noff lays out the data segment on a page
+        // boundary to make this cover all of the code.
+        if (noffH.code.size > 0) {
+            textPages = divRoundUp(noffH.code.virtualAddr + noffH.code.size, PageSize);
+            if (noffH.initData.size > 0 && noffH.initData.virtualAddr / PageSize < (int)textPages)
+                textPages = noffH.initData.virtualAddr / PageSize;
+            if (noffH.uninitData.size > 0 && noffH.uninitData.virtualAddr / PageSize < (int)textPages)
+                textPages = noffH.uninitData.virtualAddr / PageSize;
+            filePages = divRoundUp(noffH.code.virtualAddr + noffH.code.size, PageSize);
+        }
+
+        // Past the initialized data there is only bss and the stack, which
+        // are zero filled without going to the file
+        if (noffH.initData.size > 0) {
+            filePages = divRoundUp(noffH.initData.virtualAddr + noffH.initData.size, PageSize);
+        }
+        DEBUG('A', "Text pages %d, data pages %d\n", textPages, filePages - textPages);
+
     // how big is address space?
-        size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
+        size = SegmentsEnd(&noffH)
                 + UserStackSize;	// we need to increase the size
                             // to leave room for the stack
         numPages = divRoundUp(size, PageSize);
@@ -88,23 +141,22 @@ AddrSpace::AddrSpace(OpenFile *executable)
                                             // a separate page, we could set its 
                                             // pages to be read-only
             pageTable[i].shared= FALSE;
+            pageTable[i].copyOnWrite = FALSE;
             pageTable[i].cached = FALSE;
+            pageTable[i].swapSlot = -1;
             pageTable[i].threadPid = threadPid;
+            pageTable[i].nextMapping = NULL;
         }
 
         // Initially the number of valid pages and the number of shared pages is
         // zero
         countSharedPages = 0;
         validPages = 0;
-
-        // Now we have to initialize the backupMemory 
-        currentThread->initBackupMemory(numPages*PageSize);
     } else {
         unsigned int i, size;
         unsigned vpn, offset;
         TranslationEntry *entry;
         unsigned int pageFrame;
-        int threadPid = currentThread->GetPID();
 
         executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
         if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -113,7 +165,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
         ASSERT(noffH.noffMagic == NOFFMAGIC);
 
         // how big is address space?
-        size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
+        size = SegmentsEnd(&noffH)
             + UserStackSize;	// we need to increase the size
         // to leave room for the stack
         numPages = divRoundUp(size, PageSize);
@@ -133,6 +185,7 @@ AddrSpace::AddrSpace(OpenFile *executable)
         for (i = 0; i < numPages; i++) {
             pageTable[i].virtualPage = i;
             pageTable[i].physicalPage = nextUnallocatedPage++;
+            machine->InvalidateDecodedPage(pageTable[i].physicalPage);
             pageTable[i].valid = TRUE;
             pageTable[i].use = FALSE;
             pageTable[i].dirty = FALSE;
@@ -140,13 +193,16 @@ AddrSpace::AddrSpace(OpenFile *executable)
             // a separate page, we could set its 
             // pages to be read-only
             pageTable[i].shared= FALSE;
+            pageTable[i].copyOnWrite = FALSE;
             pageTable[i].cached = FALSE;
+            pageTable[i].swapSlot = -1;
             pageTable[i].threadPid = threadPid;
+            addFrameMapping(pageTable[i].physicalPage, &pageTable[i]);
         }
 
         // zero out the entire address space, to zero the unitialized data segment 
         // and the stack segment
-        bzero(&machine->mainMemory[pageTable[0].physicalPage], size);
+        bzero(&machine->mainMemory[pageTable[0].physicalPage * PageSize], size);
 
         // then, copy in the code and data segments into memory
         if (noffH.code.size > 0) {
@@ -178,145 +234,90 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace (AddrSpace*) is called by a forked thread.
-//      We need to duplicate the address space of the parent.
+//      We need to duplicate the address space of the parent.  No page is
+//      copied here: each resident page of the parent is mapped into the
+//      child as well, read-only in both, and is only copied by the first
+//      write to it (see BreakCopyOnWrite in translate.cc).
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace(AddrSpace *parentSpace, int threadPid)
 {
+    numPages = parentSpace->GetNumPages();
+    countSharedPages = parentSpace->countSharedPages;
+    validPages = parentSpace->validPages;
+    noffH = parentSpace->noffH;
+    
+    // Now we copy the executable name of the parentSpace to the childSpace
+    strcpy(filename, parentSpace->filename);
+    execId = parentSpace->execId;
+    textPages = parentSpace->textPages;
+    filePages = parentSpace->filePages;
+    clusterSize = 1;
+    nextClusterVpn = 0;
+    executableFile = NULL;
     if(pageAlgo != NORMAL) {
-        numPages = parentSpace->GetNumPages();
-        countSharedPages = parentSpace->countSharedPages;
-        validPages = parentSpace->validPages;
-        noffH = parentSpace->noffH;
-        
-        // Now we copy the executable name of the parentSpace to the childSpace
-        strcpy(filename, parentSpace->filename);
-        unsigned i,j;
-
-        DEBUG('a', "Initializing address space, num pages %d, shared %d, valid %d\n",
-                                            numPages, countSharedPages, validPages);
-
-        numPagesAllocated += validPages-countSharedPages;
-        ASSERT(numPagesAllocated <= NumPhysPages);        // check we're not trying
-                                                                                    // to run anything too big --
-                                                                                    // at least until we have
-                                                                                    // virtual memory
-
-        // first, set up the translation
-        TranslationEntry* parentPageTable = parentSpace->GetPageTable();
-        pageTable = new TranslationEntry[numPages];
-        for (i = 0; i < numPages; i++) {
-            // Shared pages have to point to the correct location
-            if(parentPageTable[i].shared == TRUE){
-                DEBUG('A', "Linking to shared page %d\n", parentPageTable[i].physicalPage);
-                pageTable[i].physicalPage = parentPageTable[i].physicalPage;
-            } else {
-                // Only allocate pages to those pages which are valid, the rest need
-                // not be allocated pages
-                if(parentPageTable[i].valid == TRUE) {
-                    // If there are pages in the free pool, use them otherwise use the next
-                    // unallocated page
-                    int *physicalPageNumber = (int *)freedPages->Remove();
-                    if(physicalPageNumber == NULL) {
-                        pageTable[i].physicalPage = nextUnallocatedPage;
-                        nextUnallocatedPage++;   // Update the number of pages allocated
-                    } else {
-                        pageTable[i].physicalPage = *physicalPageNumber;
-                        delete physicalPageNumber;
-                    }
-
-                    // This stores a refernce to the pageTable entry
-                    pageEntries[pageTable[i].physicalPage] = &pageTable[i];
-
-                    DEBUG('A', "Creating a new page %d for %d copying %d\n", pageTable[i].physicalPage, 
-                            currentThread->GetPID(), parentPageTable[i].physicalPage);
-                } else {
-                    pageTable[i].physicalPage = -1;
-                }
-            }
+        executableFile = fileSystem->Open(filename);
+        ASSERT(executableFile != NULL);
+    }
+    unsigned i;
 
-            pageTable[i].valid = parentPageTable[i].valid;
-            pageTable[i].virtualPage = i;
-            pageTable[i].use = parentPageTable[i].use;
-            pageTable[i].dirty = parentPageTable[i].dirty;
-            pageTable[i].readOnly = parentPageTable[i].readOnly;  	// if the code segment was entirely on
-                                                        // a separate page, we could set its
-                                                        // pages to be read-only
-            pageTable[i].shared= parentPageTable[i].shared;
-            pageTable[i].cached= FALSE;
-            pageTable[i].threadPid = threadPid;
-        }
+    // Keep the parent's frames from being evicted until we are done
+    // mapping them
+    pagingLock->Acquire();
 
-        // Copy the contents
-        unsigned startAddrParent, startAddrChild;
-        for (i=0; i<numPages; i++) {
-            // If the page is not shared and the page is valid then only copy
-            if(!pageTable[i].shared && pageTable[i].valid){
-                startAddrParent = parentPageTable[i].physicalPage * PageSize;
-                startAddrChild = pageTable[i].physicalPage * PageSize;
-                for(j=0; j<PageSize;++j) {
-                    machine->mainMemory[startAddrChild+j] = machine->mainMemory[startAddrParent+j];
-                }
-            }
-        }
+    DEBUG('a', "Initializing address space, num pages %d, shared %d, valid %d\n",
+                                        numPages, countSharedPages, validPages);
 
-        // Initialize the backupMemory for the child
-        threadArray[threadPid]->initBackupMemory(numPages*PageSize);
-    } else {
-        numPages = parentSpace->GetNumPages();
-        countSharedPages = parentSpace->countSharedPages;
-        validPages = parentSpace->validPages;
-        unsigned i,j, k;
-        noffH = parentSpace->noffH;
-        
-        // Now we copy the executable name of the parentSpace to the childSpace
-        strcpy(filename, parentSpace->filename);
-
-        DEBUG('a', "Initializing address space, num pages %d, shared %d\n",
-                numPages-countSharedPages, countSharedPages);
-
-        numPagesAllocated += validPages-countSharedPages;
-        ASSERT(numPagesAllocated <= NumPhysPages);        // check we're not trying
-                                                            // to run anything too big --
-                                                            // at least until we have
-                                                            // virtual memory
-
-        // first, set up the translation
-        TranslationEntry* parentPageTable = parentSpace->GetPageTable();
-        pageTable = new TranslationEntry[numPages];
-        for (i = 0, k = 0; i < numPages; i++) {
-            // Allocate a physical page only if it's not shared
-            if(parentPageTable[i].shared == TRUE){
-                pageTable[i].physicalPage = parentPageTable[i].physicalPage;
-            } else {
-                pageTable[i].physicalPage = nextUnallocatedPage++;
+    // first, set up the translation
+    TranslationEntry* parentPageTable = parentSpace->GetPageTable();
+    pageTable = new TranslationEntry[numPages];
+    for (i = 0; i < numPages; i++) {
+        pageTable[i].valid = parentPageTable[i].valid;
+        pageTable[i].virtualPage = i;
+        pageTable[i].use = parentPageTable[i].use;
+        pageTable[i].readOnly = parentPageTable[i].readOnly;  	// if the code segment was entirely on
+                                                    // a separate page, we could set its
+                                                    // pages to be read-only
+        pageTable[i].shared= parentPageTable[i].shared;
+        pageTable[i].copyOnWrite = parentPageTable[i].copyOnWrite;
+        pageTable[i].threadPid = threadPid;
+        pageTable[i].nextMapping = NULL;
+
+        // Resident pages share the parent's frame; shared memory stays
+        // writable and text read-only, anything else is copied on the
+        // first write by either.  A page an earlier fork made
+        // copy-on-write stays so in the child too
+        if(parentPageTable[i].valid) {
+            pageTable[i].physicalPage = parentPageTable[i].physicalPage;
+            addFrameMapping(pageTable[i].physicalPage, &pageTable[i]);
+            if(!parentPageTable[i].shared && !parentPageTable[i].readOnly) {
+                parentPageTable[i].readOnly = pageTable[i].readOnly = TRUE;
+                parentPageTable[i].copyOnWrite = pageTable[i].copyOnWrite = TRUE;
             }
-
-            pageTable[i].virtualPage = i;
-            pageTable[i].valid = parentPageTable[i].valid;
-            pageTable[i].use = parentPageTable[i].use;
-            pageTable[i].dirty = parentPageTable[i].dirty;
-            pageTable[i].readOnly = parentPageTable[i].readOnly;  	// if the code segment was entirely on
-                                                                    // a separate page, we could set its
-                                                                    // pages to be read-only
-            pageTable[i].shared= parentPageTable[i].shared;
-            pageTable[i].cached= FALSE;
-            pageTable[i].threadPid = threadPid;
+            DEBUG('A', "Sharing page %d with %d\n", pageTable[i].physicalPage,
+                    currentThread->GetPID());
+        } else {
+            pageTable[i].physicalPage = -1;
         }
 
-        // Copy the contents
-        unsigned startAddrParent, startAddrChild;
-        for (i=0; i<numPages; i++) {
-            // If the current page is not shared then copy
-            if(!pageTable[i].shared){
-                startAddrParent = parentPageTable[i].physicalPage * PageSize;
-                startAddrChild = pageTable[i].physicalPage * PageSize;
-                for(j=0; j<PageSize;++j) {
-                    machine->mainMemory[startAddrChild+j] = machine->mainMemory[startAddrParent+j];
-                }
+        // A page whose contents came from swap can't be re-read from the
+        // executable, so the child's copy must be written out if evicted;
+        // a page that is only in swap gets a slot of its own
+        pageTable[i].cached = FALSE;
+        pageTable[i].swapSlot = -1;
+        pageTable[i].dirty = parentPageTable[i].dirty;
+        if(parentPageTable[i].cached && !parentPageTable[i].shared) {
+            if(parentPageTable[i].valid) {
+                pageTable[i].dirty = TRUE;
+            } else {
+                pageTable[i].cached = TRUE;
+                pageTable[i].swapSlot = swapSpace->AllocateSlot();
+                pager->CopySlot(parentPageTable[i].swapSlot, pageTable[i].swapSlot);
             }
         }
     }
+
+    pagingLock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -369,11 +370,17 @@ AddrSpace::createSharedPageTable(int sharedSize, int *pagesCreated)
                                         			// a separate page, we could set its
                                         			// pages to be read-only
         pageTable[i].shared = originalPageTable[i].shared;
+        pageTable[i].copyOnWrite = originalPageTable[i].copyOnWrite;
         pageTable[i].cached = originalPageTable[i].cached;
+        pageTable[i].swapSlot = originalPageTable[i].swapSlot;
         pageTable[i].threadPid = originalPageTable[i].threadPid;
+        pageTable[i].nextMapping = NULL;
 
-        // This stores a refernce to the pageTable entry
-        pageEntries[pageTable[i].physicalPage] = &pageTable[i];
+        // The entry mapping the frame has moved
+        if(pageTable[i].valid) {
+            replaceFrameMapping(pageTable[i].physicalPage, &originalPageTable[i],
+                    &pageTable[i]);
+        }
     }
 
     // Now set up the translation entry for the shared memory region
@@ -392,19 +399,22 @@ AddrSpace::createSharedPageTable(int sharedSize, int *pagesCreated)
             delete physicalPageNumber;
         }
 
+        machine->InvalidateDecodedPage(pageTable[i].physicalPage);
+
         DEBUG('A', "Creating a shared page %d for %d\n", pageTable[i].physicalPage, 
                 currentThread->GetPID());
-        // Now store this entry into the hashMap of pageEntries
-        DEBUG('R', "Adding pageEntry for %d\n", pageTable[i].physicalPage);
-        pageEntries[pageTable[i].physicalPage] = &pageTable[i];
-
         pageTable[i].valid = TRUE;
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
         pageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
         pageTable[i].shared = TRUE; // this is a shared region
+        pageTable[i].copyOnWrite = FALSE;
         pageTable[i].cached = FALSE;
+        pageTable[i].swapSlot = -1;
         pageTable[i].threadPid = threadPid;
+
+        // Now record that this entry maps the frame
+        addFrameMapping(pageTable[i].physicalPage, &pageTable[i]);
     }
 
     // Increment the number of pages allocated by the number of shared pages
@@ -434,12 +444,12 @@ AddrSpace::~AddrSpace()
     int i;
     for(i=0; i<numPages; ++i) {
         if(pageTable[i].valid) {
-            pageEntries[pageTable[i].physicalPage] = NULL;
-            DEBUG('R', "Removing pageEntry for %d\n", pageTable[i].physicalPage);
+            removeFrameMapping(pageTable[i].physicalPage, &pageTable[i]);
         }
     }
 
     delete pageTable;
+    delete executableFile;
 }
 
 //----------------------------------------------------------------------
@@ -505,6 +515,22 @@ AddrSpace::GetNumPages()
    return numPages;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::GetPageBacking
+//      Tell where the first contents of page "vpn" come from, as laid
+//      out when the executable was loaded.
+//----------------------------------------------------------------------
+
+PageBacking
+AddrSpace::GetPageBacking(unsigned vpn)
+{
+    if (vpn < textPages)
+        return TextPage;
+    if (vpn < filePages)
+        return DataPage;
+    return ZeroFillPage;
+}
+
 TranslationEntry*
 AddrSpace::GetPageTable()
 {
@@ -513,36 +539,48 @@ AddrSpace::GetPageTable()
 
 //----------------------------------------------------------------------
 //  AddrSpace::freePages
-//  This frees the pages of the given addressSpace and adds them to the
-//  freedPages list
+//  This unmaps the pages of the given addressSpace, adds the frames no
+//  other address space maps to the freedPages list, gives back the
+//  swap slots of its pages and closes the executable
 //----------------------------------------------------------------------
 
 void AddrSpace::freePages(bool deletePT) {
-    // Run through the list of pages of the address space and add all the pages
-    // into the free pages list
-    int i, count;
-    int *temp;
-
-    for (i = 0, count = 0; i < numPages; i++) {
-        if(pageTable[i].valid && !pageTable[i].shared) {
-            count++;
-            temp = new int(pageTable[i].physicalPage);
-            freedPages->Append((void *)temp);
-            DEBUG('A', "Freeing page %d\n", pageTable[i].physicalPage);
-
-            // Remove the entry from the hashmap
-            pageEntries[pageTable[i].physicalPage] = NULL;
-
-            // delete this element from the PageQueue
-            deleteFromPageQueue(pageTable[i].physicalPage);
+    // Run through the list of pages of the address space and free every
+    // frame that was mapped by this address space alone
+    int i, frame;
+
+    for (i = 0; i < numPages; i++) {
+        if(pageTable[i].valid) {
+            frame = pageTable[i].physicalPage;
+            removeFrameMapping(frame, &pageTable[i]);
+            pageTable[i].valid = FALSE;
+            if(frameRefCount[frame] == 0) {
+                releaseFrame(frame);
+            } else if(frameRefCount[frame] == 1 &&
+                    pageEntries[frame]->copyOnWrite) {
+                // The one left needn't copy the frame before writing it.
+                // A shared text frame stays read-only: it is still in
+                // the text hash for later processes to map
+                pageEntries[frame]->readOnly = FALSE;
+                pageEntries[frame]->copyOnWrite = FALSE;
+            }
+        }
+
+        if(pageTable[i].swapSlot != -1) {
+            swapSpace->FreeSlot(pageTable[i].swapSlot);
+            pageTable[i].swapSlot = -1;
+            pageTable[i].cached = FALSE;
         }
     }
 
+    validPages = 0;
+
+    // No more pages will be read from the executable
+    delete executableFile;
+    executableFile = NULL;
+
     // delete the pageTable if yes
     if(deletePT) {
         delete pageTable;
     }
-
-    // Reduce numPagesAllocated to match the number of pages
-    numPagesAllocated -= count;
 }
@@ -19,13 +19,18 @@
 
 #define UserStackSize		1024 	// increase this as necessary!
 
-extern void deleteFromPageQueue(int value);
+// Where the contents of a page come from the first time it is touched
+enum PageBacking { TextPage,		// code only, read from the executable
+		   DataPage,		// read from the executable
+		   ZeroFillPage };	// bss and stack, zero to begin with
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
-					// initializing it with the program
-					// stored in the file "executable"
+    AddrSpace(OpenFile *executable, char *name, int threadPid);
+					// Create an address space for thread
+					// "threadPid", initializing it with
+					// the program stored in the file
+					// "executable", called "name"
 
     AddrSpace (AddrSpace *parentSpace, int threadPid);	// Used by fork
 
@@ -51,6 +56,19 @@ class AddrSpace {
     NoffHeader noffH; // This is the noffheader which stores information
     char filename[300]; // This is a pointer to the name of the file
 
+    OpenFile *executableFile;	// filename, open while pages may be
+				// loaded from it (NULL under NORMAL)
+    int clusterSize;		// pages read on the last fault from it
+    unsigned nextClusterVpn;	// the page after the last ones read
+
+    int execId;		// executableId(filename)
+    unsigned textPages;	// pages [0, textPages) hold nothing but code, and
+			// are shared with other processes running filename
+    unsigned filePages;	// pages [textPages, filePages) hold initialized
+			// data; the rest have nothing in the file
+
+    PageBacking GetPageBacking(unsigned vpn);
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
@@ -6,6 +6,8 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
+#include <strings.h>
+
 #include "copyright.h"
 #include "bitmap.h"
 
@@ -22,8 +24,8 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -82,6 +84,49 @@ BitMap::Test(int which)
 	return FALSE;
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextClear, BitMap::NextSet
+// 	Return the number of the first clear (set) bit at or after
+//	"from", or numBits if there is none.  Words with no such bit are
+//	skipped whole; ffs finds the lowest such bit in the first word
+//	that has one.  The bits past numBits in the last word are
+//	never set.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int from)
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = ~map[w] & (~0U << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = ~map[w];
+    }
+    return min(w * BitsInWord + ffs((int) bits) - 1, numBits);
+}
+
+int
+BitMap::NextSet(int from)
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = map[w] & (~0U << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = map[w];
+    }
+    return min(w * BitsInWord + ffs((int) bits) - 1, numBits);
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
 // 	Return the number of the first bit which is clear.
@@ -94,27 +139,87 @@ BitMap::Test(int which)
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    int i = NextClear(0);
+
+    if (i == numBits)
+	return -1;
+    Mark(i);
+    return i;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find "count" consecutive clear bits, set them, and return the
+//	number of the first; "*length" is set to "count".  In order of
+//	preference, the bits are:
+//
+//	  the first "count" clear bits that do not cross a multiple of
+//	    "boundary" (if "count" is no more than "boundary")
+//	  the first run of at least "count" clear bits
+//
+//	If there are not that many consecutive clear bits anywhere, the
+//	longest run there is is taken instead, and "*length" is set to
+//	its length.  If no bits are clear, return -1.
+//
+//	For a disk, "boundary" is the size of a track: a run of sectors
+//	within one track can be read in a single rotation.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count, int boundary, int *length)
+{
+    int start, end, piece, blockEnd, i;
+    int found = -1, fits = -1, longest = -1, longestLength = 0;
+
+    ASSERT(count > 0 && boundary > 0);
+    for (start = NextClear(0); (found == -1) && (start < numBits);
+		start = NextClear(end)) {
+	end = NextSet(start);
+	for (piece = start; (count <= boundary) && (piece + count <= end);
+		piece = blockEnd) {
+	    blockEnd = (piece / boundary + 1) * boundary;
+	    if (piece + count <= blockEnd) {
+		found = piece;
+		break;
+	    }
 	}
-    return -1;
+	if ((fits == -1) && (end - start >= count))
+	    fits = start;
+	if (end - start > longestLength) {
+	    longest = start;
+	    longestLength = end - start;
+	}
+    }
+
+    if (found == -1)
+	found = fits;
+    if (found == -1) {
+	found = longest;
+	count = longestLength;
+    }
+    *length = count;
+    for (i = 0; i < count; i++)
+	Mark(found + i);
+    return found;
 }
 
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//	Counts the set bits a word at a time, clearing the lowest set
+//	bit until none are left.
 //----------------------------------------------------------------------
 
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
+    int count = numBits;
+    unsigned int bits;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
+    for (int i = 0; i < numWords; i++)
+	for (bits = map[i]; bits != 0; bits &= bits - 1)
+	    count--;
     return count;
 }
 
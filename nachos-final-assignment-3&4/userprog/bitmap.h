@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	go a word at a time, skipping full (or empty) words, and find the
+//	bit they want within a word with ffs.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -43,6 +45,11 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int count, int boundary, int *length);
+				// Find and set up to "count" consecutive
+				// clear bits, within one "boundary"-aligned
+				// block if possible; return the first, and
+				// how many in "*length"
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -59,6 +66,11 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+
+    int NextClear(int from);		// first clear bit at or after "from",
+					// numBits if none
+    int NextSet(int from);		// first set bit at or after "from",
+					// numBits if none
 };
 
 #endif // BITMAP_H
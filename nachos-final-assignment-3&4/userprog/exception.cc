@@ -24,12 +24,14 @@
 #define MAX_SEMAPHORE_COUNT 1000
 #define MAX_CV_COUNT 1000
 
+#include <limits.h>
+
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
-#include "console.h"
 #include "synch.h"
 #include "synchop.h"
+#include "filetable.h"
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -53,11 +55,6 @@
 //	"which" is the kind of exception.  The list of possible exceptions 
 //	are in machine.h.
 //----------------------------------------------------------------------
-static Semaphore *readAvail;
-static Semaphore *writeDone;
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
-
 extern void StartProcess (char*);
 extern void StartExec(char*);
 
@@ -71,6 +68,14 @@ Condition *cvs[MAX_CV_COUNT];
 int cv_list[MAX_CV_COUNT];
 int cv_count = 0;
 
+// The open file table of the current process, made on first use
+static FileTable *Files ()
+{
+   if (currentThread->files == NULL)
+      currentThread->files = new FileTable;
+   return currentThread->files;
+}
+
 void
 ForkStartFunction (int dummy)
 {
@@ -78,40 +83,24 @@ ForkStartFunction (int dummy)
    machine->Run();
 }
 
-static void ConvertIntToHex (unsigned v, Console *console)
-{
-   unsigned x;
-   if (v == 0) return;
-   ConvertIntToHex (v/16, console);
-   x = v % 16;
-   if (x < 10) {
-      writeDone->P() ;
-      console->PutChar('0'+x);
-   }
-   else {
-      writeDone->P() ;
-      console->PutChar('a'+x-10);
-   }
-}
-
 void
 ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
-    int memval, paddr, vaddr, printval, tempval, exp;
+    int vaddr, tempval;
     unsigned printvalus;	// Used for printing in hex
-    if (!initializedConsoleSemaphores) {
-       readAvail = new Semaphore("read avail", 0);
-       writeDone = new Semaphore("write done", 1);
-       initializedConsoleSemaphores = true;
-    }
-    Console *console = new Console(NULL, NULL, ReadAvail, WriteDone, 0);
     int exitcode;		// Used in SC_Exit
     unsigned i;
-    char buffer[1024];		// Used in SC_Exec
+    char buffer[1024];		// Used in SC_Exec, the Print calls and
+				// the file system calls
+    int count;			// Used in the Print calls, SC_Read, SC_Write
+    int size, n;		// Used in SC_Read, SC_Write
+    OpenFile *file;		// Used in SC_Open, SC_Spawn
+    SharedFile *shared;		// Used in SC_Read, SC_Write
     int waitpid;		// Used in SC_Join
     int whichChild;		// Used in SC_Join
-    Thread *child;		// Used by SC_Fork
+    Thread *child;		// Used by SC_Fork, SC_Spawn
+    int nice;			// Used by SC_Spawn
     unsigned sleeptime;		// Used by SC_Sleep
     int sharedSize; // Used by SC_ShmAllocate
     unsigned sharedMemoryStart; // Used by SC_ShmAllocate
@@ -123,10 +112,12 @@ ExceptionHandler(ExceptionType which)
 
     if ((which == SyscallException) && (type == SC_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
+	synchConsole->Flush();		// let queued output reach the display
    	interrupt->Halt();
     }
     else if ((which == SyscallException) && (type == SC_Exit)) {
        exitcode = machine->ReadRegister(4);
+       synchConsole->Flush();		// the process's output comes first
        printf("[pid %d]: Exit called. Code: %d\n", currentThread->GetPID(), exitcode);
        // We do not wait for the children to finish.
        // The children will continue to run.
@@ -142,30 +133,17 @@ ExceptionHandler(ExceptionType which)
     else if ((which == SyscallException) && (type == SC_Exec)) {
        // Copy the executable name into kernel space
        vaddr = machine->ReadRegister(4);
-
-       // There is a possibility of a PageFault and so we need to reexecute this
-       // instructions until we get a valid value
-       returnValue = FALSE;
-       while(returnValue != TRUE) {
-           returnValue = machine->ReadMem(vaddr, 1, &memval);
+       if (machine->CopyInString(vaddr, buffer, sizeof(buffer)) != -1) {
+          StartExec(buffer);
+          DEBUG('C', "%s", buffer);
        }
 
-       i = 0;
-       while ((*(char*)&memval) != '\0') {
-          buffer[i] = (*(char*)&memval);
-          i++;
-          vaddr++;
-
-          // There is a possibility of a PageFault and so we need to reexecute this
-          // instructions until we get a valid value
-          returnValue = FALSE;
-          while(returnValue != TRUE) {
-              returnValue = machine->ReadMem(vaddr, 1, &memval);
-          }
-       }
-       buffer[i] = (*(char*)&memval);
-       StartExec(buffer);
-       DEBUG('C', "%s", buffer);
+       // StartExec only returns if the program could not be started
+       machine->WriteRegister(2, -1);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
     else if ((which == SyscallException) && (type == SC_Join)) {
        waitpid = machine->ReadRegister(4);
@@ -196,12 +174,46 @@ ExceptionHandler(ExceptionType which)
        
        child = new Thread("Forked thread", GET_NICE_FROM_PARENT);
        child->space = new AddrSpace (currentThread->space, child->GetPID());  // Duplicates the address space
+       if (currentThread->files != NULL)
+          child->files = new FileTable (currentThread->files);	// Shares the open files
        child->SaveUserState ();		     		      // Duplicate the register set
        child->ResetReturnValue ();			     // Sets the return register to zero
        child->StackAllocate (ForkStartFunction, 0);	// Make it ready for a later context switch
        child->Schedule ();
        machine->WriteRegister(2, child->GetPID());		// Return value for parent
     }
+    else if ((which == SyscallException) && (type == SC_Spawn)) {
+       vaddr = machine->ReadRegister(4);
+       nice = machine->ReadRegister(5);
+       if ((nice < MIN_NICE_PRIORITY) || (nice > MAX_NICE_PRIORITY))
+          nice = GET_NICE_FROM_PARENT;
+       id = -1;
+       if (machine->CopyInString(vaddr, buffer, sizeof(buffer)) != -1) {
+          file = fileSystem->Open(buffer);
+          if (file != NULL) {
+             // Load the executable straight into the child's own space
+             child = new Thread("Spawned thread", nice);
+             child->space = new AddrSpace (file, buffer, child->GetPID());
+             delete file;
+             if (currentThread->files != NULL)
+                child->files = new FileTable (currentThread->files);	// Shares the open files
+             // InitRegisters works on the machine registers, which
+             // still hold ours
+             currentThread->SaveUserState ();
+             child->space->InitRegisters ();		// Starts at the entry point
+             child->SaveUserState ();
+             currentThread->RestoreUserState ();
+             child->StackAllocate (ForkStartFunction, 0);
+             child->Schedule ();
+             id = child->GetPID();
+          }
+       }
+       machine->WriteRegister(2, id);		// Return value for parent
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
     else if ((which == SyscallException) && (type == SC_Yield)) {
        currentThread->Yield();
        // Advance program counters.
@@ -210,39 +222,15 @@ ExceptionHandler(ExceptionType which)
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
     else if ((which == SyscallException) && (type == SC_PrintInt)) {
-       printval = machine->ReadRegister(4);
-       if (printval == 0) {
-          writeDone->P() ;
-          console->PutChar('0');
-       }
-       else {
-          if (printval < 0) {
-             writeDone->P() ;
-             console->PutChar('-');
-             printval = -printval;
-          }
-          tempval = printval;
-          exp=1;
-          while (tempval != 0) {
-             tempval = tempval/10;
-             exp = exp*10;
-          }
-          exp = exp/10;
-          while (exp > 0) {
-             writeDone->P() ;
-             console->PutChar('0'+(printval/exp));
-             printval = printval % exp;
-             exp = exp/10;
-          }
-       }
+       count = sprintf(buffer, "%d", machine->ReadRegister(4));
+       synchConsole->Write(buffer, count);
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
     else if ((which == SyscallException) && (type == SC_PrintChar)) {
-        writeDone->P() ;        // wait for previous write to finish
-        console->PutChar(machine->ReadRegister(4));   // echo it!
+       synchConsole->PutChar(machine->ReadRegister(4));
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -251,25 +239,112 @@ ExceptionHandler(ExceptionType which)
     else if ((which == SyscallException) && (type == SC_PrintString)) {
        vaddr = machine->ReadRegister(4);
 
-       // There is a possibility of a PageFault and so we need to reexecute this
-       // instructions until we get a valid value
-       returnValue = FALSE;
-       while(returnValue != TRUE) {
-           returnValue = machine->ReadMem(vaddr, 1, &memval);
+       // Copy the string in a buffer at a time; a full buffer means
+       // there may be more
+       do {
+          count = machine->CopyInString(vaddr, buffer, sizeof(buffer));
+          synchConsole->Write(buffer, count);
+          vaddr += count;
+       } while (count == (int)sizeof(buffer) - 1);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SC_Create)) {
+       vaddr = machine->ReadRegister(4);
+       if ((machine->CopyInString(vaddr, buffer, sizeof(buffer)) != -1)
+             && fileSystem->Create(buffer, 0)) {
+          machine->WriteRegister(2, 0);
        }
-
-       while ((*(char*)&memval) != '\0') {
-          writeDone->P() ;
-          console->PutChar(*(char*)&memval);
-          vaddr++;
-
-          // There is a possibility of a PageFault and so we need to reexecute this
-          // instructions until we get a valid value
-          returnValue = FALSE;
-          while(returnValue != TRUE) {
-              returnValue = machine->ReadMem(vaddr, 1, &memval);
+       else machine->WriteRegister(2, -1);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SC_Open)) {
+       vaddr = machine->ReadRegister(4);
+       id = -1;
+       if (machine->CopyInString(vaddr, buffer, sizeof(buffer)) != -1) {
+          file = fileSystem->Open(buffer);
+          if (file != NULL) {
+             id = Files()->Add(file);
+             if (id == -1) delete file;		// table full
+          }
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SC_Read)) {
+       vaddr = machine->ReadRegister(4);
+       size = machine->ReadRegister(5);
+       id = machine->ReadRegister(6);
+       count = 0;
+       if (id == ConsoleInput) {
+          // Wait for one character, then take those already there
+          while (count < size) {
+             if ((count > 0) && !synchConsole->CharAvailable()) break;
+             buffer[0] = synchConsole->GetChar();
+             if (!machine->CopyOut(buffer, 1, vaddr + count)) break;
+             count++;
+          }
+       }
+       else if ((shared = Files()->Get(id)) != NULL) {
+          // The file stays open while we sleep on the disk
+          shared->Hold();
+          while (count < size) {
+             n = shared->file->Read(buffer, min(size - count, (int)sizeof(buffer)));
+             if ((n <= 0) || !machine->CopyOut(buffer, n, vaddr + count)) break;
+             count += n;
           }
+          shared->Drop();
        }
+       else count = -1;
+       machine->WriteRegister(2, count);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SC_Write)) {
+       vaddr = machine->ReadRegister(4);
+       size = machine->ReadRegister(5);
+       id = machine->ReadRegister(6);
+       count = 0;
+       if (id == ConsoleOutput) {
+          while (count < size) {
+             n = min(size - count, (int)sizeof(buffer));
+             if (!machine->CopyIn(vaddr + count, n, buffer)) break;
+             synchConsole->Write(buffer, n);
+             count += n;
+          }
+       }
+       else if ((shared = Files()->Get(id)) != NULL) {
+          // The file stays open while we sleep on the disk
+          shared->Hold();
+          while (count < size) {
+             n = min(size - count, (int)sizeof(buffer));
+             if (!machine->CopyIn(vaddr + count, n, buffer)) break;
+             n = shared->file->Write(buffer, n);
+             if (n <= 0) break;
+             count += n;
+          }
+          shared->Drop();
+       }
+       else count = -1;
+       machine->WriteRegister(2, count);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SC_Close)) {
+       id = machine->ReadRegister(4);
+       machine->WriteRegister(2, Files()->Close(id) ? 0 : -1);
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -311,7 +386,12 @@ ExceptionHandler(ExceptionType which)
           currentThread->Yield();
        }
        else {
-          currentThread->SortedInsertInWaitQueue (sleeptime+stats->totalTicks);
+          // A time past what the clock can count means sleeping for as
+          // long as it can (INT_MAX itself is the queue's "nothing armed")
+          if (sleeptime > (unsigned)(INT_MAX - 1 - stats->totalTicks))
+             timeouts->SleepUntil (INT_MAX - 1);
+          else
+             timeouts->SleepUntil (sleeptime+stats->totalTicks);
        }
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
@@ -327,17 +407,8 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SC_PrintIntHex)) {
        printvalus = (unsigned)machine->ReadRegister(4);
-       writeDone->P() ;
-       console->PutChar('0');
-       writeDone->P() ;
-       console->PutChar('x');
-       if (printvalus == 0) {
-          writeDone->P() ;
-          console->PutChar('0');
-       }
-       else {
-          ConvertIntToHex (printvalus, console);
-       }
+       count = sprintf(buffer, "0x%x", printvalus);
+       synchConsole->Write(buffer, count);
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -427,20 +498,18 @@ ExceptionHandler(ExceptionType which)
                 delete semaphores[id];
                 returnValue = 0;
             } else if ( op == SYNCH_GET ) {
-                // Translare the vaddr to a paddr and then return the value of the
-                // semaphore into this address
-                paddr = machine->GetPA(vaddr);
-                if(paddr != -1) {
-                    machine->mainMemory[paddr] = semaphores[id]->getValue();
+                // Store the value of the semaphore at vaddr, as a whole
+                // word in the machine's byte order
+                tempval = WordToMachine(semaphores[id]->getValue());
+                if(machine->CopyOut((char *)&tempval, sizeof(int), vaddr)) {
                     returnValue = 0;
                 }
             } else if ( op == SYNCH_SET ) {
-                // Translate the vaddr to a paddr and then write the value stored at
-                // that location in to the value of the semaphore
-                paddr = machine->GetPA(vaddr);
-                if(paddr != -1) {
+                // Read the word stored at vaddr in to the value of the
+                // semaphore
+                if(machine->CopyIn(vaddr, sizeof(int), (char *)&tempval)) {
                     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
-                    semaphores[id]->setValue(machine->mainMemory[paddr]);
+                    semaphores[id]->setValue(WordToHost(tempval));
                     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
                     returnValue = 0;
                 }
@@ -530,9 +599,8 @@ ExceptionHandler(ExceptionType which)
         // Return the starting address of the shared memory region
         machine->WriteRegister(2, returnValue);
     } else if (which == PageFaultException)  {
-        // Set the status of the thread to BLOCKED and then it goes for sleep
-        // for a 1000 ticks, to model the pageFault latency
-        currentThread->SortedInsertInWaitQueue (1000+stats->totalTicks);
+        // The thread has already slept while the pager brought the page
+        // in, for as long as the disk took; the instruction is retried
         stats->numPageFaults++;
     } else {
         printf("Unexpected user mode exception %d %d\n", which, type);
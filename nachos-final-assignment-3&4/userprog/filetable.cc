@@ -0,0 +1,131 @@
+// filetable.cc
+//	Routines to manage the files a user process has open.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "syscall.h"
+#include "filetable.h"
+
+//----------------------------------------------------------------------
+// SharedFile::SharedFile
+// 	Wrap a newly opened file, with one reference to it.
+//----------------------------------------------------------------------
+
+SharedFile::SharedFile(OpenFile *openFile)
+{
+    file = openFile;
+    refs = 1;
+}
+
+//----------------------------------------------------------------------
+// SharedFile::Hold, SharedFile::Drop
+// 	Add or remove a reference.  When the last one is dropped, the
+//	file is closed.
+//----------------------------------------------------------------------
+
+void
+SharedFile::Hold()
+{
+    refs++;
+}
+
+void
+SharedFile::Drop()
+{
+    ASSERT(refs > 0);
+    if (--refs == 0) {
+	delete file;
+	delete this;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileTable::FileTable
+// 	Initialize the table of a new process: only the console is open.
+//----------------------------------------------------------------------
+
+FileTable::FileTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	files[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// FileTable::FileTable(FileTable*)
+// 	Initialize the table of a forked child, with the files of
+//	"parent".  Both processes share them.
+//----------------------------------------------------------------------
+
+FileTable::FileTable(FileTable *parent)
+{
+    for (int i = 0; i < MaxOpenFiles; i++) {
+	files[i] = parent->files[i];
+	if (files[i] != NULL)
+	    files[i]->Hold();
+    }
+}
+
+//----------------------------------------------------------------------
+// FileTable::~FileTable
+// 	Let go of every file still open, when the process exits.
+//----------------------------------------------------------------------
+
+FileTable::~FileTable()
+{
+    for (int i = 0; i < MaxOpenFiles; i++)
+	if (files[i] != NULL)
+	    files[i]->Drop();
+}
+
+//----------------------------------------------------------------------
+// FileTable::Add
+// 	Give "file", newly opened, the lowest free id, and return it;
+//	return -1 if every id is taken.
+//----------------------------------------------------------------------
+
+int
+FileTable::Add(OpenFile *file)
+{
+    for (int i = ConsoleOutput + 1; i < MaxOpenFiles; i++)
+	if (files[i] == NULL) {
+	    files[i] = new SharedFile(file);
+	    return i;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FileTable::Get
+// 	Return the open file with "id", or NULL if there is none (the
+//	console ids included).
+//----------------------------------------------------------------------
+
+SharedFile *
+FileTable::Get(int id)
+{
+    if ((id < 0) || (id >= MaxOpenFiles))
+	return NULL;
+    return files[id];
+}
+
+//----------------------------------------------------------------------
+// FileTable::Close
+// 	Free "id", letting go of its file.  Return FALSE if it was not
+//	an open file.
+//----------------------------------------------------------------------
+
+bool
+FileTable::Close(int id)
+{
+    SharedFile *shared = Get(id);
+
+    if (shared == NULL)
+	return FALSE;
+    files[id] = NULL;
+    shared->Drop();
+    return TRUE;
+}
@@ -0,0 +1,62 @@
+// filetable.h
+//	Data structures for the files a user process has open.
+//
+//	A process names its open files by OpenFileId, a small integer
+//	indexing its table.  The first two ids are the console (cf.
+//	syscall.h), and are always open.  A child made by Fork starts with
+//	a copy of its parent's table, and shares the open files with it,
+//	positions included, as in UNIX; a file is only closed when the
+//	last table that has it lets go.  The table belongs to the thread,
+//	so it stays the same across Exec.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+#define MaxOpenFiles	16	// ids in a process's table, with the console
+
+// An open file, with a count of the references to it: from the tables
+// that have it, and from system calls using it (which may sleep while
+// the file is closed).
+
+class SharedFile {
+  public:
+    SharedFile(OpenFile *openFile);	// One reference, to "openFile"
+
+    OpenFile *file;
+
+    void Hold();			// Add a reference
+    void Drop();			// Remove one; the last closes the
+					// file, and deletes this
+
+  private:
+    int refs;
+};
+
+// The table of a process's open files.
+
+class FileTable {
+  public:
+    FileTable();			// Only the console open
+    FileTable(FileTable *parent);	// A copy of "parent", for Fork
+    ~FileTable();			// Let go of every file
+
+    int Add(OpenFile *file);		// Enter a newly opened file; return
+					// its id, or -1 if the table is full
+    SharedFile *Get(int id);		// The file with "id", NULL if it is
+					// not an open file
+    bool Close(int id);			// Let go of "id"; FALSE if it was
+					// not an open file
+
+  private:
+    SharedFile *files[MaxOpenFiles];	// NULL where the id is free, and
+					// for the console
+};
+
+#endif // FILETABLE_H
@@ -0,0 +1,202 @@
+// pager.cc
+//	Routines to queue paging I/O, and the pager thread that does it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pager.h"
+
+//----------------------------------------------------------------------
+// PagingRequest::PagingRequest
+// 	Initialize a request to do "what"; the caller fills in the rest.
+//----------------------------------------------------------------------
+
+PagingRequest::PagingRequest(PagingOp what)
+{
+    op = what;
+    slot = toSlot = -1;
+    frames = NULL;
+    count = 0;
+    file = NULL;
+    position = 0;
+    done = NULL;
+}
+
+//----------------------------------------------------------------------
+// PagerThread
+// 	The procedure the pager thread runs.  "arg" is the Pager.
+//----------------------------------------------------------------------
+
+static void
+PagerThread(int arg)
+{
+    ((Pager *)arg)->Serve();
+}
+
+//----------------------------------------------------------------------
+// Pager::Pager
+// 	Initialize an idle pager.
+//----------------------------------------------------------------------
+
+Pager::Pager()
+{
+    requests = new SynchList;
+    thread = NULL;
+}
+
+//----------------------------------------------------------------------
+// Pager::~Pager
+// 	De-allocate the pager.  Only called when Nachos is done, when the
+//	pager thread is not running.
+//----------------------------------------------------------------------
+
+Pager::~Pager()
+{
+    delete requests;
+}
+
+//----------------------------------------------------------------------
+// Pager::Queue
+// 	Hand "request" to the pager thread, starting it if need be.
+//----------------------------------------------------------------------
+
+void
+Pager::Queue(PagingRequest *request)
+{
+    if (thread == NULL) {
+	thread = new Thread("pager", MIN_NICE_PRIORITY, TRUE);
+	thread->Fork(PagerThread, (int)this);
+    }
+    requests->Append((void *)request);
+}
+
+//----------------------------------------------------------------------
+// Pager::Wait
+// 	Queue "request", and sleep until the pager has done it.
+//----------------------------------------------------------------------
+
+void
+Pager::Wait(PagingRequest *request)
+{
+    Semaphore done("paging request", 0);
+
+    request->done = &done;
+    Queue(request);
+    done.P();
+}
+
+//----------------------------------------------------------------------
+// Pager::PageIn
+// 	Read the page kept in "slot" into physical page "pageFrame".
+//	Nothing may map the frame until this returns.
+//----------------------------------------------------------------------
+
+void
+Pager::PageIn(int slot, int pageFrame)
+{
+    PagingRequest request(SwapIn);
+
+    request.slot = slot;
+    request.frames = &pageFrame;
+    Wait(&request);
+}
+
+//----------------------------------------------------------------------
+// Pager::PageOut
+// 	Queue a write of physical page "pageFrame" to "slot".  The page
+//	is copied into the request, so the frame may be reused as soon
+//	as this returns.
+//----------------------------------------------------------------------
+
+void
+Pager::PageOut(int slot, int pageFrame)
+{
+    PagingRequest *request = new PagingRequest(SwapOut);
+
+    request->slot = slot;
+    bcopy(&machine->mainMemory[pageFrame * PageSize], request->data, PageSize);
+    Queue(request);
+}
+
+//----------------------------------------------------------------------
+// Pager::CopySlot
+// 	Queue a copy of the page kept in slot "from" into slot "to", for
+//	a forked address space whose parent has the page in swap only.
+//----------------------------------------------------------------------
+
+void
+Pager::CopySlot(int from, int to)
+{
+    PagingRequest *request = new PagingRequest(SwapCopy);
+
+    request->slot = from;
+    request->toSlot = to;
+    Queue(request);
+}
+
+//----------------------------------------------------------------------
+// Pager::ReadPages
+// 	Read "count" consecutive pages of "file", starting at "position",
+//	into physical pages "frames".  Past the end of the file is zeroes.
+//----------------------------------------------------------------------
+
+void
+Pager::ReadPages(OpenFile *file, int position, int *frames, int count)
+{
+    PagingRequest request(FileIn);
+
+    request.file = file;
+    request.position = position;
+    request.frames = frames;
+    request.count = count;
+    Wait(&request);
+}
+
+//----------------------------------------------------------------------
+// Pager::Serve
+// 	The body of the pager thread: take the requests in order, and do
+//	each one, sleeping while the disk works on it.
+//----------------------------------------------------------------------
+
+void
+Pager::Serve()
+{
+    PagingRequest *request;
+    char *buffer;
+    int i;
+
+    for (;;) {
+	request = (PagingRequest *)requests->Remove();
+	switch (request->op) {
+	  case SwapIn:
+	    swapSpace->PageIn(request->slot, request->frames[0]);
+	    break;
+	  case SwapOut:
+	    swapSpace->PageOut(request->slot, request->data);
+	    break;
+	  case SwapCopy:
+	    swapSpace->CopySlot(request->slot, request->toSlot);
+	    break;
+	  case FileIn:
+	    DEBUG('S', "Reading %d pages at %d of an executable\n",
+			request->count, request->position);
+	    buffer = new char[request->count * PageSize];
+	    bzero(buffer, request->count * PageSize);
+	    request->file->ReadAt(buffer, request->count * PageSize,
+			request->position);
+	    for (i = 0; i < request->count; i++)
+		bcopy(&buffer[i * PageSize],
+			&machine->mainMemory[request->frames[i] * PageSize],
+			PageSize);
+	    delete [] buffer;
+	    break;
+	}
+	if (request->done != NULL)
+	    request->done->V();
+	else
+	    delete request;
+    }
+}
@@ -0,0 +1,82 @@
+// pager.h
+//	Data structures for the pager -- the kernel thread that does all
+//	the disk I/O of demand paging.
+//
+//	A page fault only decides which frame a page goes into; the
+//	transfer itself is queued for the pager, and the faulting thread
+//	sleeps until the pager has done it.  Meanwhile other threads run,
+//	and the time the fault takes is whatever the disk needs for it
+//	(seek, rotation and transfer, from Disk::ComputeLatency).  Pages
+//	evicted to swap are written behind: a copy of the page is queued,
+//	and the frame can be reused at once.
+//
+//	The pager serves requests in the order they were made, so a read
+//	of a swap slot always sees the last write queued for it, and a
+//	slot copy sees the page that was written to it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "copyright.h"
+#include "synchlist.h"
+#include "openfile.h"
+#include "machine.h"
+
+// What a request asks the pager to do.
+
+enum PagingOp { SwapIn, SwapOut, SwapCopy, FileIn };
+
+// A request to the pager.  The ones a thread waits for live on its
+// stack; the pager deletes the others once they are done.
+
+class PagingRequest {
+  public:
+    PagingRequest(PagingOp what);
+
+    PagingOp op;
+    int slot;				// swap slot read, written or copied
+    int toSlot;				// SwapCopy: where the copy goes
+    int *frames;			// SwapIn, FileIn: the frames filled
+    int count;				// FileIn: how many frames
+    OpenFile *file;			// FileIn: the file read
+    int position;			// FileIn: where in the file
+    char data[PageSize];		// SwapOut: the page written
+    Semaphore *done;			// signalled when the request is
+					// done; NULL if nobody waits
+};
+
+// The pager.  Its thread is started on the first request, so a run
+// that never pages does not have one.
+
+class Pager {
+  public:
+    Pager();
+    ~Pager();
+
+    void PageIn(int slot, int pageFrame);	// Read "slot" into a frame,
+					// returning when the data is there
+    void PageOut(int slot, int pageFrame);	// Queue a write of the frame
+					// as it is now to "slot"
+    void CopySlot(int from, int to);	// Queue a copy of one slot to another
+    void ReadPages(OpenFile *file, int position, int *frames, int count);
+					// Read "count" pages from "file"
+					// into "frames", returning when done
+
+    void Serve();			// The pager thread: do requests
+					// forever
+
+  private:
+    SynchList *requests;		// requests not yet served
+    Thread *thread;			// the pager thread, NULL until the
+					// first request
+
+    void Queue(PagingRequest *request);
+    void Wait(PagingRequest *request);	// queue "request" and sleep
+					// until it is done
+};
+
+#endif // PAGER_H
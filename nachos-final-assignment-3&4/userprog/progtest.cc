@@ -40,9 +40,8 @@ StartProcess(char *filename)
     }
 
     // Create a new address space and pass it the name of the executable
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable, filename, currentThread->GetPID());
     currentThread->space = space;
-    strcpy(space->filename, filename);
 
     delete executable; // close the file
 
@@ -78,14 +77,10 @@ StartExec(char *filename)
     // Create a new address space and pass it the name of the executable
     if(pageAlgo != NORMAL) {
         currentThread->space->freePages(TRUE);
-
-        // delete the old backupMemory
-        delete currentThread->backupMemory;
     }
 
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable, filename, currentThread->GetPID());
     currentThread->space = space;
-    strcpy(space->filename, filename);
 
     delete executable; // close the file
 
@@ -207,7 +202,7 @@ ReadInputAndFork (char *filename)
       }
       sprintf(buffer,"Thread_%d",i+1);
       Thread *child = new Thread(buffer, priority[i]);
-      child->space = new AddrSpace (inFile);
+      child->space = new AddrSpace (inFile, batchProcesses[i], child->GetPID());
       delete inFile;
       child->space->InitRegisters();             // set the initial register values
       child->SaveUserState ();
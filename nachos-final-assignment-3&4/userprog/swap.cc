@@ -0,0 +1,113 @@
+// swap.cc 
+//	Routines to manage the swap space used by demand paging.
+//
+//	Only dirty pages ever reach the swap disk: a clean page can always
+//	be read again from wherever it came from (the executable, or a
+//	slot it was written to before and has not been modified since).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swap.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Initialize the swap disk, and mark all of its slots free.  The
+//	contents of the disk are meaningless across runs of Nachos.
+//
+//	"name" -- UNIX file name to be used as storage for the swap disk
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(char *name)
+{
+    disk = new SynchDisk(name, SwapTracks);
+    slotMap = new BitMap(NumSwapSlots);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	De-allocate the swap space.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    delete slotMap;
+    delete disk;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::AllocateSlot
+// 	Return the number of a free slot, marking it in use.  We can't
+//	run without a place to put an evicted dirty page, so running out
+//	of swap space is fatal.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::AllocateSlot()
+{
+    int slot = slotMap->Find();
+
+    ASSERT(slot != -1);		// out of swap space
+    DEBUG('S', "Allocating swap slot %d\n", slot);
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::FreeSlot
+// 	Return "slot" to the pool of free slots.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::FreeSlot(int slot)
+{
+    ASSERT(slotMap->Test(slot));
+    DEBUG('S', "Freeing swap slot %d\n", slot);
+    slotMap->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::PageIn
+// 	Read the page kept in "slot" into physical page "pageFrame".
+//	Returns once the disk request has completed.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::PageIn(int slot, int pageFrame)
+{
+    DEBUG('S', "Reading swap slot %d into frame %d\n", slot, pageFrame);
+    disk->ReadSector(slot, &machine->mainMemory[pageFrame * PageSize]);
+    stats->numPageIns++;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::PageOut
+// 	Write the page in "data" to "slot".
+//----------------------------------------------------------------------
+
+void
+SwapSpace::PageOut(int slot, char *data)
+{
+    DEBUG('S', "Writing a page to swap slot %d\n", slot);
+    disk->WriteSector(slot, data);
+    stats->numPageOuts++;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::CopySlot
+// 	Copy the page kept in slot "from" into slot "to", for a forked
+//	address space whose parent has the page in swap only.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::CopySlot(int from, int to)
+{
+    char *buffer = new char[PageSize];
+
+    DEBUG('S', "Copying swap slot %d to %d\n", from, to);
+    disk->ReadSector(from, buffer);
+    disk->WriteSector(to, buffer);
+    delete [] buffer;
+}
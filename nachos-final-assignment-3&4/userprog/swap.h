@@ -0,0 +1,49 @@
+// swap.h 
+//	Data structures for the swap device -- the simulated disk on which
+//	demand paging keeps dirty pages that have been evicted from main
+//	memory, until they are faulted back in.
+//
+//	The swap disk has the same geometry as the file system disk, but
+//	more tracks.  A page is exactly one sector, so a page's place on
+//	the swap disk (its "slot") is just a sector number; a bitmap
+//	records which slots are in use.  A page gets a slot the first time
+//	it is written out, and keeps it until its address space goes away.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "synchdisk.h"
+
+#define SwapTracks	512	// size of the swap disk
+#define NumSwapSlots	(SwapTracks * SectorsPerTrack)
+
+// The following class defines the swap space.  PageIn and PageOut move
+// one page between memory and a slot; like SynchDisk, they return only
+// once the (simulated) transfer has finished.  Only the pager thread
+// calls them (see pager.h); faulting threads wait for the pager.
+
+class SwapSpace {
+  public:
+    SwapSpace(char *name);		// Initialize the swap disk, stored
+					// in the UNIX file "name"
+    ~SwapSpace();			// De-allocate the swap space
+
+    int AllocateSlot();			// Find a free slot and mark it used
+    void FreeSlot(int slot);		// Give a slot back
+
+    void PageIn(int slot, int pageFrame);	// Read "slot" into a frame
+    void PageOut(int slot, char *data);	// Write a page to "slot"
+    void CopySlot(int from, int to);		// Duplicate a page in swap
+
+  private:
+    SynchDisk *disk;			// the swap disk
+    BitMap *slotMap;			// which slots are in use
+};
+
+#endif // SWAP_H
@@ -0,0 +1,204 @@
+// synchconsole.cc
+//	Routines for the console driver: queueing output for the writer
+//	thread, and waiting for input.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "synchconsole.h"
+
+// Dummy functions because C++ can't indirectly invoke member functions
+static void ConsoleReadAvail(int arg)
+{ ((SynchConsole *)arg)->ReadAvail(); }
+static void ConsoleWriteDone(int arg)
+{ ((SynchConsole *)arg)->WriteDone(); }
+static void ConsoleWriter(int arg)
+{ ((SynchConsole *)arg)->WriterDaemon(); }
+
+//----------------------------------------------------------------------
+// SynchConsole::SynchConsole
+// 	Initialize the driver, with nothing queued.  The device itself is
+//	made on first use.
+//----------------------------------------------------------------------
+
+SynchConsole::SynchConsole()
+{
+    console = NULL;
+    readAvail = new Semaphore("console read avail", 0);
+    writeDone = new Semaphore("console write done", 0);
+    head = count = 0;
+    lock = new Lock("console lock");
+    notEmpty = new Condition("console not empty");
+    notFull = new Condition("console not full");
+    drained = new Condition("console drained");
+    writer = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::~SynchConsole
+// 	De-allocate the driver.  Only called when Nachos is done.
+//----------------------------------------------------------------------
+
+SynchConsole::~SynchConsole()
+{
+    if (console != NULL)
+	delete console;
+    delete readAvail;
+    delete writeDone;
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+    delete drained;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Start
+// 	Make the device (on stdin and stdout) the first time the console
+//	is used.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Start()
+{
+    if (console == NULL)
+	console = new Console(NULL, NULL, ConsoleReadAvail, ConsoleWriteDone,
+			(int)this);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::ReadAvail, SynchConsole::WriteDone
+// 	Interrupt handlers: a character has come in, or the device has
+//	written what it was given.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::ReadAvail()
+{
+    readAvail->V();
+}
+
+void
+SynchConsole::WriteDone()
+{
+    writeDone->V();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Write
+// 	Queue "n" characters for the display, and return as soon as
+//	they are all in the buffer.  Output from one call is never mixed
+//	with another's unless it does not fit in the buffer.
+//
+//	"from" -- the characters
+//	"n" -- how many there are
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Write(char *from, int n)
+{
+    int room, tail, i;
+
+    if (n <= 0)
+	return;
+    lock->Acquire();
+    Start();
+    if (writer == NULL) {
+	writer = new Thread("console writer", MIN_NICE_PRIORITY, TRUE);
+	writer->Fork(ConsoleWriter, (int)this);
+    }
+    while (n > 0) {
+	while (count == ConsoleBufferSize)
+	    notFull->Wait(lock);
+	room = min(n, ConsoleBufferSize - count);
+	tail = (head + count) % ConsoleBufferSize;
+	for (i = 0; i < room; i++)
+	    ring[(tail + i) % ConsoleBufferSize] = from[i];
+	count += room;
+	from += room;
+	n -= room;
+	notEmpty->Signal(lock);
+    }
+    lock->Release();
+}
+
+void
+SynchConsole::PutChar(char ch)
+{
+    Write(&ch, 1);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Flush
+// 	Wait until everything queued so far has been written.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Flush()
+{
+    lock->Acquire();
+    while (count > 0)
+	drained->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::WriterDaemon
+// 	The body of the writer thread.  Hand the device everything in the
+//	buffer (up to where it wraps around) as one request, and free the
+//	space when the device is done.  Threads go on queueing output
+//	meanwhile, behind the part being written.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::WriterDaemon()
+{
+    int n;
+
+    for (;;) {
+	lock->Acquire();
+	while (count == 0)
+	    notEmpty->Wait(lock);
+	n = min(count, ConsoleBufferSize - head);
+	lock->Release();
+
+	DEBUG('c', "Console writing %d characters\n", n);
+	console->PutChars(&ring[head], n);
+	writeDone->P();
+
+	lock->Acquire();
+	head = (head + n) % ConsoleBufferSize;
+	count -= n;
+	notFull->Broadcast(lock);
+	if (count == 0)
+	    drained->Broadcast(lock);
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::GetChar, SynchConsole::CharAvailable
+// 	Wait for a character from the keyboard; or check whether one can
+//	be had without waiting.
+//----------------------------------------------------------------------
+
+char
+SynchConsole::GetChar()
+{
+    char ch;
+
+    Start();
+    do {
+	readAvail->P();
+	ch = console->GetChar();
+    } while (ch == EOF);
+    return ch;
+}
+
+bool
+SynchConsole::CharAvailable()
+{
+    return (console != NULL) && (readAvail->getValue() > 0);
+}
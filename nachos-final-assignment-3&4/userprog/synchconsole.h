@@ -0,0 +1,71 @@
+// synchconsole.h
+//	Data structures for the kernel's console driver -- the one
+//	console device shared by every user program, with synchronous
+//	routines for the system calls to use.
+//
+//	Output is written behind.  A thread printing copies its characters
+//	into a ring buffer and goes on; a writer thread hands whatever the
+//	buffer holds to the device in one request, and frees the space once
+//	the device is done with it.  The device still takes ConsoleTime per
+//	character, so the simulated time output takes does not change; only
+//	the number of requests (and of host writes) does.  A thread only
+//	waits for the device when the buffer is full, or when it asks for
+//	everything written so far to be out (Flush).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHCONSOLE_H
+#define SYNCHCONSOLE_H
+
+#include "copyright.h"
+#include "console.h"
+#include "synch.h"
+
+#define ConsoleBufferSize	1024	// characters of output not yet written
+
+// The console driver.  The device and the writer thread are started on
+// first use, so a run that never touches the console has neither.
+
+class SynchConsole {
+  public:
+    SynchConsole();
+    ~SynchConsole();
+
+    void PutChar(char ch);		// Queue a character for the display
+    void Write(char *from, int n);	// Queue "n" characters, in
+					// order, waiting for room if need be
+    void Flush();			// Wait until all queued output has
+					// been written
+
+    char GetChar();			// Wait for a character from the
+					// keyboard, and return it
+    bool CharAvailable();		// Has a character come in that
+					// GetChar can return at once?
+
+    void WriterDaemon();		// The writer thread: hand queued
+					// output to the device, forever
+
+    void ReadAvail();			// Interrupt handlers of the device
+    void WriteDone();
+
+  private:
+    Console *console;			// the device, NULL until first used
+    Semaphore *readAvail;		// a character has come in
+    Semaphore *writeDone;		// the device finished a write
+    char ring[ConsoleBufferSize];	// output not yet written, in order
+    int head;				// first character in "ring"
+    int count;				// characters in "ring", including
+					// those the device is writing
+    Lock *lock;				// protects the ring
+    Condition *notEmpty;		// signalled when output is queued
+    Condition *notFull;			// broadcast when space is freed
+    Condition *drained;			// broadcast when all output is out
+    Thread *writer;			// the writer thread, NULL until the
+					// first output
+
+    void Start();			// make the device, if need be
+};
+
+#endif // SYNCHCONSOLE_H
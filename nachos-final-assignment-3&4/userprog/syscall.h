@@ -57,6 +57,8 @@
 
 #define SC_ShmAllocate	27
 
+#define SC_Spawn	28
+
 #ifndef IN_ASM
 
 /* The system call interface.  These are the operations the Nachos
@@ -73,7 +75,7 @@
 void Halt();		
  
 
-/* Address space control operations: Exit, Exec, and Join */
+/* Address space control operations: Exit, Exec, Join and Spawn */
 
 /* This user program is done (status = 0 means exited normally). */
 void Exit(int status);	
@@ -90,6 +92,14 @@ void Exec(char *name);
  * Return the exit status.
  */
 int Join(SpaceId id); 	
+
+/* Run the executable "name" as a new child process, and return its id
+ * (for Join), or -1 if it cannot be opened.  Unlike Fork followed by
+ * Exec, the parent's address space is never copied.  The child runs at
+ * "nice" (0 to 100), or at its parent's priority if "nice" is outside
+ * that range; it shares its parent's open files, as after Fork.
+ */
+SpaceId Spawn(char *name, int nice);
  
 
 /* File system operations: Create, Open, Read, Write, Close
@@ -113,26 +123,36 @@ typedef int OpenFileId;
 #define ConsoleInput	0  
 #define ConsoleOutput	1  
  
-/* Create a Nachos file, with "name" */
-void Create(char *name);
+/* Create a Nachos file, with "name", empty.  Return 0, or -1 if it
+ * could not be created.
+ */
+int Create(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
- * be used to read and write to the file.
+ * be used to read and write to the file, or -1 if it cannot be opened.
+ * A process has at most 16 ids open, the console's included; a child
+ * made by Fork shares its parent's open files.
  */
 OpenFileId Open(char *name);
 
-/* Write "size" bytes from "buffer" to the open file. */
-void Write(char *buffer, int size, OpenFileId id);
+/* Write "size" bytes from "buffer" to the open file, growing it if
+ * need be.  Return the number of bytes written, or -1 for a bad id.
+ */
+int Write(char *buffer, int size, OpenFileId id);
 
 /* Read "size" bytes from the open file into "buffer".  
  * Return the number of bytes actually read -- if the open file isn't
  * long enough, or if it is an I/O device, and there aren't enough 
  * characters to read, return whatever is available (for I/O devices, 
  * you should always wait until you can return at least one character).
+ * Return -1 for a bad id.
  */
 int Read(char *buffer, int size, OpenFileId id);
 
-/* Close the file, we're done reading and writing to it. */
+/* Close the file, we're done reading and writing to it.  Closing an
+ * id that is not open does nothing.  (Close returns nothing: the kernel
+ * is built with this header, and its host Close(int) is void.)
+ */
 void Close(OpenFileId id);
 
 